@@ -72,6 +72,11 @@ namespace Profiler.ViewModels
 			new Flag("Switch Contexts", "Collect Switch Context events (kernel)", Mode.SWITCH_CONTEXT, true),
 			new Flag("Autosampling", "Sample all threads (kernel)", Mode.AUTOSAMPLING, true),
 			new Flag("SysCalls", "Collect system calls ", Mode.SYS_CALLS, true),
+			new Flag("CPU Time", "Collect thread CPU time for frames and marked events", Mode.CPU_TIME, false),
+			new Flag("System Counters", "Sample memory, page faults, context switches and run-queue latency of the process", Mode.SYSTEM_COUNTERS, false),
+			new Flag("Allocations", "Record heap allocations (OPTICK_ALLOC/OPTICK_FREE or liboptick-malloc-shim.so)", Mode.ALLOCATIONS, false),
+			new Flag("Allocation Callstacks", "Collect sampled callstacks for the allocations (requires Allocations)", Mode.ALLOCATION_CALLSTACKS, false),
+			new Flag("Locks", "Collect contention and ownership time of the instrumented locks (Optick::Mutex, OPTICK_LOCKABLE)", Mode.LOCKS, false),
 			new Flag("GPU", "Collect GPU events", Mode.GPU, true),
 			new Flag("All Processes", "Collects information about other processes (thread pre-emption)", Mode.OTHER_PROCESSES, true),
 		});
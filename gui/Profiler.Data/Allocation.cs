@@ -0,0 +1,109 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Profiler.Data
+{
+	public enum AllocationType : byte
+	{
+		Alloc,
+		Free,
+	}
+
+	public struct AllocationEvent : IComparable<AllocationEvent>, ITick
+	{
+		public long Start { get; set; }
+		public UInt64 Address { get; set; }
+		public UInt64 Size { get; set; }
+		public AllocationType Type { get; set; }
+		// Leaf node in the callstack tree of the CallstackPack (0 - callstack wasn't sampled)
+		public uint StackID { get; set; }
+
+		public AllocationEvent(BinaryReader reader) : this()
+		{
+			Start = Durable.ReadTime(reader);
+			Address = reader.ReadUInt64();
+			Size = reader.ReadUInt64();
+			Type = (AllocationType)reader.ReadByte();
+			StackID = reader.ReadUInt32();
+		}
+
+		public int CompareTo(AllocationEvent other)
+		{
+			return Start.CompareTo(other.Start);
+		}
+	}
+
+	// Allocations of the thread
+	public class AllocationPack : ThreadPack<AllocationEvent>
+	{
+		public AllocationPack(DataResponse response) : base(response)
+		{
+			ReadItems(reader => new AllocationEvent(reader));
+		}
+
+		public override void Apply(FrameGroup group, ThreadData thread)
+		{
+			if (thread != null)
+				thread.Allocations = Items;
+
+			group.AddAllocations(this);
+		}
+	}
+
+	public class AllocationBoard
+	{
+		// Allocations from all the threads (sorted by time)
+		public List<AllocationEvent> Events { get; private set; } = new List<AllocationEvent>();
+
+		public void Add(AllocationPack pack)
+		{
+			Events.AddRange(pack.Items);
+			Events.Sort();
+		}
+
+		// Number of allocations in [start, finish) (e.g. for a frame)
+		public int CountAllocations(long start, long finish)
+		{
+			int index = Utils.BinarySearchClosestIndex(Events, start);
+			if (index < 0)
+				index = 0;
+
+			int count = 0;
+			for (int i = index; i < Events.Count && Events[i].Start < finish; ++i)
+				if (Events[i].Start >= start && Events[i].Type == AllocationType.Alloc)
+					++count;
+
+			return count;
+		}
+
+		// Bytes which weren't freed by the specified time grouped by the sampled callstack (StackID 0 - unsampled allocations)
+		public Dictionary<uint, UInt64> GetLiveHeap(long time = long.MaxValue)
+		{
+			Dictionary<UInt64, AllocationEvent> live = new Dictionary<UInt64, AllocationEvent>();
+
+			foreach (AllocationEvent ev in Events)
+			{
+				if (ev.Start > time)
+					break;
+
+				if (ev.Type == AllocationType.Alloc)
+					live[ev.Address] = ev;
+				else
+					live.Remove(ev.Address);
+			}
+
+			Dictionary<uint, UInt64> result = new Dictionary<uint, UInt64>();
+			foreach (AllocationEvent ev in live.Values)
+			{
+				UInt64 size = 0;
+				result.TryGetValue(ev.StackID, out size);
+				result[ev.StackID] = size + ev.Size;
+			}
+			return result;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Profiler.Data
+{
+	public class AsyncEvent : Durable
+	{
+		public EventDescription Description { get; set; }
+		public UInt64 ID { get; set; }
+		public int Lane { get; set; }
+
+		public String Name => Description != null ? Description.FullName : String.Empty;
+
+		public AsyncEvent(BinaryReader reader, EventDescriptionBoard board)
+		{
+			ReadDurable(reader);
+			int descriptionID = reader.ReadInt32();
+			Description = (0 <= descriptionID && descriptionID < board.Board.Count) ? board.Board[descriptionID] : null;
+			ID = reader.ReadUInt64();
+			Lane = reader.ReadInt32();
+		}
+	}
+
+	// Spans of the storage, the lane count precedes the common item list
+	public class AsyncPack : ThreadPack<AsyncEvent>
+	{
+		// Spans packed into non-overlapping lanes (sub-tracks), each lane is sorted by time
+		public List<List<AsyncEvent>> Lanes { get; private set; }
+
+		public AsyncPack(DataResponse response, FrameGroup group) : base(response)
+		{
+			int laneCount = response.Reader.ReadInt32();
+			Lanes = new List<List<AsyncEvent>>(laneCount);
+			for (int i = 0; i < laneCount; ++i)
+				Lanes.Add(new List<AsyncEvent>());
+
+			ReadItems(reader => new AsyncEvent(reader, group.Board));
+
+			foreach (AsyncEvent ev in Items)
+				if (0 <= ev.Lane && ev.Lane < laneCount)
+					Lanes[ev.Lane].Add(ev);
+		}
+
+		public override void Apply(FrameGroup group, ThreadData thread)
+		{
+			if (thread != null)
+				thread.AsyncLanes = Lanes;
+		}
+	}
+}
@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Collections.Generic;
+using System.IO;
 using System.Linq;
 using System.Text;
 using System.Threading.Tasks;
@@ -22,10 +23,20 @@ namespace Profiler.Data
 		public Dictionary<UInt64, List<Callstack>> CallstackMap { get; set; }
 		public override DataResponse Response { get; set; }
 
+		// Prefix tree of the unique callstacks (NETWORK_PROTOCOL_VERSION_28+), shared with the allocation callstacks
+		uint[] Parents { get; set; }
+		SamplingDescription[] Descriptions { get; set; }
+
 		public static CallstackPack Create(DataResponse response, ISamplingBoard board, SysCallBoard sysCallBoard)
 		{
 			CallstackPack result = new CallstackPack() { Response = response, CallstackMap = new Dictionary<ulong, List<Callstack>>() };
 
+			if (response.Version >= NetworkProtocol.NETWORK_PROTOCOL_VERSION_28)
+			{
+				result.ReadCallstackTree(response.Reader, board, sysCallBoard);
+				return result;
+			}
+
 			ulong totalCount = response.Reader.ReadUInt32();
 
 			for (ulong i = 0; i < totalCount;)
@@ -72,5 +83,77 @@ namespace Profiler.Data
 
 			return result;
 		}
+
+		// {NodeCount, {ParentIndex, Address}}, {Count, {ThreadID, Timestamp, NodeIndex}}
+		void ReadCallstackTree(BinaryReader reader, ISamplingBoard board, SysCallBoard sysCallBoard)
+		{
+			uint nodeCount = reader.ReadUInt32();
+
+			// Node 0 is the root of the tree (empty callstack), parent always precedes its children
+			uint[] parents = new uint[nodeCount + 1];
+			SamplingDescription[] descriptions = new SamplingDescription[nodeCount + 1];
+
+			for (uint node = 1; node <= nodeCount; ++node)
+			{
+				parents[node] = reader.ReadUInt32();
+				descriptions[node] = board.GetDescription(reader.ReadUInt64());
+			}
+
+			uint totalCount = reader.ReadUInt32();
+
+			for (uint i = 0; i < totalCount; ++i)
+			{
+				UInt64 threadID = reader.ReadUInt64();
+				UInt64 timestamp = reader.ReadUInt64();
+				uint leaf = reader.ReadUInt32();
+
+				Callstack callstack = new Callstack() { Start = (long)timestamp, Reason = CallStackReason.AutoSample };
+
+				if (sysCallBoard != null && sysCallBoard.HasSysCall(threadID, callstack.Start))
+					callstack.Reason = CallStackReason.SysCall;
+
+				for (uint node = leaf; node != 0 && node <= nodeCount; node = parents[node])
+				{
+					if (!descriptions[node].IsIgnore)
+						callstack.Add(descriptions[node]);
+				}
+
+				// Tree is walked from leaf to root
+				callstack.Reverse();
+
+				List<Callstack> callstacks;
+				if (!CallstackMap.TryGetValue(threadID, out callstacks))
+				{
+					callstacks = new List<Callstack>();
+					CallstackMap.Add(threadID, callstacks);
+				}
+
+				callstacks.Add(callstack);
+			}
+
+			foreach (List<Callstack> cs in CallstackMap.Values)
+			{
+				cs.Sort();
+			}
+
+			Parents = parents;
+			Descriptions = descriptions;
+		}
+
+		// Resolves a leaf node of the callstack tree (e.g. AllocationEvent.StackID) to a callstack (from root to leaf)
+		public Callstack GetCallstack(uint stackID)
+		{
+			if (Parents == null || stackID == 0 || stackID >= Parents.Length)
+				return null;
+
+			Callstack callstack = new Callstack();
+			for (uint node = stackID; node != 0 && node < Parents.Length; node = Parents[node])
+			{
+				if (!Descriptions[node].IsIgnore)
+					callstack.Add(Descriptions[node]);
+			}
+			callstack.Reverse();
+			return callstack;
+		}
 	}
 }
@@ -31,8 +31,11 @@ namespace Profiler.Data
 		public const UInt32 NETWORK_PROTOCOL_VERSION_24 = 24; // Adding Modules
 		public const UInt32 NETWORK_PROTOCOL_VERSION_25 = 25; // Adding ThreadID to the frame list
 		public const UInt32 NETWORK_PROTOCOL_VERSION_26 = 26; // Adding FrameType to the FrameHeader
+		public const UInt32 NETWORK_PROTOCOL_VERSION_27 = 27; // Adding StreamFlags to the Handshake response (optional compression of the network dumps)
+		public const UInt32 NETWORK_PROTOCOL_VERSION_28 = 28; // Callstacks are stored as a prefix tree of the unique stacks
+		public const UInt32 NETWORK_PROTOCOL_VERSION_29 = 29; // String tags are stored as offset + length in the per-storage string arena
 
-		public const UInt32 NETWORK_PROTOCOL_VERSION = NETWORK_PROTOCOL_VERSION_26;
+		public const UInt32 NETWORK_PROTOCOL_VERSION = NETWORK_PROTOCOL_VERSION_29;
 		public const UInt32 NETWORK_PROTOCOL_MIN_VERSION = NETWORK_PROTOCOL_VERSION_18;
 
 		public const UInt16 OPTICK_APP_ID = 0xB50F;
@@ -62,6 +65,13 @@ namespace Profiler.Data
 			SyscallPack,
 			SummaryPack,
 			FramesPack,
+			WakeupPack,
+			CounterPack,
+			AllocationPack,
+			LockPack,
+			FlowPack,
+			AsyncPack,
+			MarkPack,
 		}
 		public UInt16 ApplicationID { get; set; }
 		public Type ResponseType { get; set; }
@@ -0,0 +1,48 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Profiler.Data
+{
+	public struct CounterSample : IComparable<CounterSample>, ITick
+	{
+		public long Start { get; set; }
+		public EventDescription Description { get; set; }
+		public double Value { get; set; }
+
+		public String Name => Description != null ? Description.FullName : String.Empty;
+
+		public CounterSample(BinaryReader reader, EventDescriptionBoard board) : this()
+		{
+			Start = Durable.ReadTime(reader);
+			int descriptionID = reader.ReadInt32();
+			Description = (0 <= descriptionID && descriptionID < board.Board.Count) ? board.Board[descriptionID] : null;
+			Value = reader.ReadDouble();
+		}
+
+		public int CompareTo(CounterSample other)
+		{
+			return Start.CompareTo(other.Start);
+		}
+	}
+
+	// Counter samples of the thread
+	public class CounterPack : ThreadPack<CounterSample>
+	{
+		public CounterPack(DataResponse response, FrameGroup group) : base(response)
+		{
+			ReadItems(reader => new CounterSample(reader, group.Board));
+		}
+
+		public override void Apply(FrameGroup group, ThreadData thread)
+		{
+			if (thread != null)
+				thread.Counters = Items;
+
+			group.AddCounterSamples(Items);
+		}
+	}
+}
@@ -0,0 +1,95 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Profiler.Data
+{
+	public enum FlowEventType : byte
+	{
+		Begin,
+		End,
+	}
+
+	public struct FlowEvent : IComparable<FlowEvent>, ITick
+	{
+		public long Start { get; set; }
+		public UInt64 ID { get; set; }
+		public EventDescription Description { get; set; }
+		public FlowEventType Type { get; set; }
+		public int ThreadIndex { get; set; }
+
+		public FlowEvent(BinaryReader reader, EventDescriptionBoard board, int threadIndex) : this()
+		{
+			Start = Durable.ReadTime(reader);
+			ID = reader.ReadUInt64();
+			int descriptionID = reader.ReadInt32();
+			Description = (0 <= descriptionID && descriptionID < board.Board.Count) ? board.Board[descriptionID] : null;
+			Type = (FlowEventType)reader.ReadByte();
+			ThreadIndex = threadIndex;
+		}
+
+		public int CompareTo(FlowEvent other)
+		{
+			return Start.CompareTo(other.Start);
+		}
+	}
+
+	// Job enqueue (Begin) and the start of its execution (End), possibly on different threads
+	public class FlowLink
+	{
+		public FlowEvent Begin { get; set; }
+		public FlowEvent End { get; set; }
+
+		public long Latency => End.Start - Begin.Start;
+	}
+
+	// Flow markers of the thread
+	public class FlowPack : ThreadPack<FlowEvent>
+	{
+		public FlowPack(DataResponse response, FrameGroup group) : base(response)
+		{
+			ReadItems(reader => new FlowEvent(reader, group.Board, ThreadIndex));
+		}
+
+		public override void Apply(FrameGroup group, ThreadData thread)
+		{
+			if (thread != null)
+				thread.Flows = Items;
+
+			group.AddFlows(this);
+		}
+	}
+
+	public class FlowBoard
+	{
+		List<FlowEvent> events = new List<FlowEvent>();
+
+		// Matched Begin\End pairs (sorted by the Begin time)
+		public List<FlowLink> Links { get; private set; } = new List<FlowLink>();
+
+		public void Add(FlowPack pack)
+		{
+			events.AddRange(pack.Items);
+			events.Sort();
+
+			// IDs could be reused - each End is linked with the latest Begin
+			Dictionary<UInt64, FlowEvent> pending = new Dictionary<UInt64, FlowEvent>();
+			Links = new List<FlowLink>();
+
+			foreach (FlowEvent ev in events)
+			{
+				FlowEvent begin;
+				if (ev.Type == FlowEventType.Begin)
+					pending[ev.ID] = ev;
+				else if (pending.TryGetValue(ev.ID, out begin))
+				{
+					Links.Add(new FlowLink() { Begin = begin, End = ev });
+					pending.Remove(ev.ID);
+				}
+			}
+		}
+	}
+}
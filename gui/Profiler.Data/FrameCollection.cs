@@ -18,6 +18,13 @@ namespace Profiler.Data
 		public List<EventFrame> Events { get; set; }
 		public List<Callstack> Callstacks { get; set; }
 		public List<SysCallEntry> SysCalls { get; set; }
+		public List<WakeupEvent> Wakeups { get; set; }
+		public List<CounterSample> Counters { get; set; }
+		public List<MarkEvent> Marks { get; set; }
+		public List<AllocationEvent> Allocations { get; set; }
+		public List<LockEvent> Locks { get; set; }
+		public List<FlowEvent> Flows { get; set; }
+		public List<List<AsyncEvent>> AsyncLanes { get; set; }
 		public Synchronization Sync { get; set; }
 		public FiberSynchronization FiberSync { get; set; }
 		public TagsPack TagsPack { get; set; }
@@ -123,6 +130,12 @@ namespace Profiler.Data
 	{
 		public String Name { get; set; }
 		public SysCallBoard SysCallsBoard { get; protected set; }
+		public WakeupBoard WakeupBoard { get; protected set; }
+		// Counter samples from all the threads grouped by name (sorted by time)
+		public Dictionary<String, List<CounterSample>> CounterTracks { get; protected set; }
+		public AllocationBoard AllocationBoard { get; protected set; }
+		public CallstackPack CallstackPack { get; protected set; }
+		public FlowBoard FlowBoard { get; protected set; }
 		public EventDescriptionBoard Board { get; set; }
 		public ISamplingBoard SamplingBoard { get; set; }
 		public List<ThreadData> Threads { get; set; }
@@ -365,11 +378,27 @@ namespace Profiler.Data
 			}
 		}
 
+		public void AddWakeups(WakeupBoard wakeupBoard)
+		{
+			System.Diagnostics.Debug.Assert(wakeupBoard != null && wakeupBoard.Response != null, "Invalid WakeupPack response");
+
+			Responses.Add(wakeupBoard.Response);
+			WakeupBoard = wakeupBoard;
+
+			foreach (var pair in wakeupBoard.WakeupMap)
+			{
+				ThreadData thread = GetThread(pair.Key);
+				if (thread != null)
+					thread.Wakeups = pair.Value;
+			}
+		}
+
 		public void AddCallStackPack(CallstackPack pack)
 		{
 			System.Diagnostics.Debug.Assert(pack != null && pack.Response != null, "Invalid CallstackPack response");
 
 			Responses.Add(pack.Response);
+			CallstackPack = pack;
 
 			for (int i = 0; i < Threads.Count; ++i)
 			{
@@ -468,6 +497,50 @@ namespace Profiler.Data
 				Threads[pack.ThreadIndex].TagsPack = pack;
 		}
 
+		public void Add(ThreadPack pack)
+		{
+			Responses.Add(pack.Response);
+			ThreadData thread = (0 <= pack.ThreadIndex && pack.ThreadIndex < Threads.Count) ? Threads[pack.ThreadIndex] : null;
+			pack.Apply(this, thread);
+		}
+
+		// Per-name tracks merged from all the threads
+		public void AddCounterSamples(List<CounterSample> samples)
+		{
+			if (CounterTracks == null)
+				CounterTracks = new Dictionary<String, List<CounterSample>>();
+
+			foreach (CounterSample sample in samples)
+			{
+				List<CounterSample> track = null;
+				if (!CounterTracks.TryGetValue(sample.Name, out track))
+				{
+					track = new List<CounterSample>();
+					CounterTracks.Add(sample.Name, track);
+				}
+				track.Add(sample);
+			}
+
+			foreach (List<CounterSample> track in CounterTracks.Values)
+				track.Sort();
+		}
+
+		public void AddAllocations(AllocationPack pack)
+		{
+			if (AllocationBoard == null)
+				AllocationBoard = new AllocationBoard();
+
+			AllocationBoard.Add(pack);
+		}
+
+		public void AddFlows(FlowPack pack)
+		{
+			if (FlowBoard == null)
+				FlowBoard = new FlowBoard();
+
+			FlowBoard.Add(pack);
+		}
+
 		public ThreadData GetThread(UInt64 threadID)
 		{
 			int threadIndex = -1;
@@ -682,6 +755,16 @@ namespace Profiler.Data
 						break;
 					}
 
+				case DataResponse.Type.WakeupPack:
+					{
+						int id = response.Reader.ReadInt32();
+						FrameGroup group = groups[id];
+
+						group.AddWakeups(WakeupBoard.Create(response, group));
+
+						break;
+					}
+
 				case DataResponse.Type.CallstackPack:
 					{
 						int id = response.Reader.ReadInt32();
@@ -714,6 +797,22 @@ namespace Profiler.Data
 						break;
 					}
 
+				case DataResponse.Type.CounterPack:
+				case DataResponse.Type.AllocationPack:
+				case DataResponse.Type.LockPack:
+				case DataResponse.Type.FlowPack:
+				case DataResponse.Type.AsyncPack:
+				case DataResponse.Type.MarkPack:
+					{
+						int id = response.Reader.ReadInt32();
+						if (groups.ContainsKey(id))
+						{
+							FrameGroup group = groups[id];
+							group.Add(ThreadPack.Create(response, group));
+						}
+						break;
+					}
+
 
 				case DataResponse.Type.FramesPack:
 					{
@@ -0,0 +1,48 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Profiler.Data
+{
+	public enum LockEventType : byte
+	{
+		Wait,
+		Hold,
+	}
+
+	public class LockEvent : Durable
+	{
+		public EventDescription Description { get; set; }
+		public UInt64 Address { get; set; }
+		public LockEventType Type { get; set; }
+
+		public String Name => Description != null ? Description.FullName : String.Empty;
+
+		public LockEvent(BinaryReader reader, EventDescriptionBoard board)
+		{
+			ReadDurable(reader);
+			int descriptionID = reader.ReadInt32();
+			Description = (0 <= descriptionID && descriptionID < board.Board.Count) ? board.Board[descriptionID] : null;
+			Address = reader.ReadUInt64();
+			Type = (LockEventType)reader.ReadByte();
+		}
+	}
+
+	// Contended acquires and exclusive ownership intervals of the thread
+	public class LockPack : ThreadPack<LockEvent>
+	{
+		public LockPack(DataResponse response, FrameGroup group) : base(response)
+		{
+			ReadItems(reader => new LockEvent(reader, group.Board));
+		}
+
+		public override void Apply(FrameGroup group, ThreadData thread)
+		{
+			if (thread != null)
+				thread.Locks = Items;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Profiler.Data
+{
+	public struct MarkEvent : IComparable<MarkEvent>, ITick
+	{
+		public long Start { get; set; }
+		public EventDescription Description { get; set; }
+
+		public String Name => Description != null ? Description.FullName : String.Empty;
+
+		public MarkEvent(BinaryReader reader, EventDescriptionBoard board) : this()
+		{
+			Start = Durable.ReadTime(reader);
+			int descriptionID = reader.ReadInt32();
+			Description = (0 <= descriptionID && descriptionID < board.Board.Count) ? board.Board[descriptionID] : null;
+		}
+
+		public int CompareTo(MarkEvent other)
+		{
+			return Start.CompareTo(other.Start);
+		}
+	}
+
+	// Instant markers of the thread
+	public class MarkPack : ThreadPack<MarkEvent>
+	{
+		public MarkPack(DataResponse response, FrameGroup group) : base(response)
+		{
+			ReadItems(reader => new MarkEvent(reader, group.Board));
+		}
+
+		public override void Apply(FrameGroup group, ThreadData thread)
+		{
+			if (thread != null)
+				thread.Marks = Items;
+		}
+	}
+}
@@ -27,5 +27,10 @@ namespace Profiler.Data
 		RESERVED_4 = (1 << 15),
 		SYS_CALLS = (1 << 16),
 		OTHER_PROCESSES = (1 << 17),
+		CPU_TIME = (1 << 20),
+		SYSTEM_COUNTERS = (1 << 21),
+		ALLOCATIONS = (1 << 22),
+		ALLOCATION_CALLSTACKS = (1 << 23),
+		LOCKS = (1 << 24),
 	}
 }
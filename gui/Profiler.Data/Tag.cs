@@ -106,6 +106,15 @@ namespace Profiler.Data
 			Value = Utils.ReadBinaryString(reader);
 		}
 
+		// NETWORK_PROTOCOL_VERSION_29+: the value is stored in the string arena of the storage
+		public void Read(BinaryReader reader, EventDescriptionBoard board, byte[] arena)
+		{
+			base.Read(reader, board);
+			int offset = reader.ReadInt32();
+			int length = reader.ReadInt32();
+			Value = (0 <= offset && 0 <= length && offset + length <= arena.Length) ? Encoding.UTF8.GetString(arena, offset, length) : String.Empty;
+		}
+
 		public override String FormattedValue => Value;
 	}
 
@@ -159,7 +168,10 @@ namespace Profiler.Data
 					LoadTags<TagVec3>();
 					reader.ReadInt32(); // Skip
 					reader.ReadInt32(); // Skip
-					LoadTags<TagString>();
+					if (Response.Version >= NetworkProtocol.NETWORK_PROTOCOL_VERSION_29)
+						LoadStringTags();
+					else
+						LoadTags<TagString>();
 
 					tags.Sort();
 
@@ -169,6 +181,22 @@ namespace Profiler.Data
 			}
 		}
 
+		void LoadStringTags()
+		{
+			BinaryReader reader = Response.Reader;
+
+			// Single blob per storage, tags reference the strings by offset and length
+			byte[] arena = reader.ReadBytes(reader.ReadInt32());
+
+			int count = reader.ReadInt32();
+			for (int i = 0; i < count; ++i)
+			{
+				TagString val = new TagString();
+				val.Read(reader, Group.Board, arena);
+				tags.Add(val);
+			}
+		}
+
 		void LoadTags<T>() where T : Tag, new()
 		{
 			BinaryReader reader = Response.Reader;
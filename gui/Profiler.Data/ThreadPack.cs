@@ -0,0 +1,60 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace Profiler.Data
+{
+	// Per-thread pack of the capture: ThreadIndex, Count, Count x Item
+	public abstract class ThreadPack : IResponseHolder
+	{
+		public override DataResponse Response { get; set; }
+		public int ThreadIndex { get; private set; } = -1;
+
+		protected ThreadPack(DataResponse response)
+		{
+			Response = response;
+			ThreadIndex = response.Reader.ReadInt32();
+		}
+
+		// Attaches the data to the thread (null if the index is out of range) and to the boards of the group
+		public abstract void Apply(FrameGroup group, ThreadData thread);
+
+		public static ThreadPack Create(DataResponse response, FrameGroup group)
+		{
+			switch (response.ResponseType)
+			{
+				case DataResponse.Type.CounterPack:
+					return new CounterPack(response, group);
+				case DataResponse.Type.AllocationPack:
+					return new AllocationPack(response);
+				case DataResponse.Type.LockPack:
+					return new LockPack(response, group);
+				case DataResponse.Type.FlowPack:
+					return new FlowPack(response, group);
+				case DataResponse.Type.AsyncPack:
+					return new AsyncPack(response, group);
+				case DataResponse.Type.MarkPack:
+					return new MarkPack(response, group);
+			}
+			return null;
+		}
+	}
+
+	public abstract class ThreadPack<T> : ThreadPack where T : ITick
+	{
+		// Records of the thread (sorted by time)
+		public List<T> Items { get; private set; }
+
+		protected ThreadPack(DataResponse response) : base(response) { }
+
+		protected void ReadItems(Func<BinaryReader, T> read)
+		{
+			int count = Response.Reader.ReadInt32();
+			Items = new List<T>(count);
+			for (int i = 0; i < count; ++i)
+				Items.Add(read(Response.Reader));
+
+			Items.Sort((a, b) => a.Start.CompareTo(b.Start));
+		}
+	}
+}
@@ -0,0 +1,83 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Profiler.Data
+{
+	public struct WakeupEvent : IComparable<WakeupEvent>, ITick
+	{
+		public long Start { get; set; }
+		public UInt64 WakerThreadID { get; set; }
+		public UInt64 WakeeThreadID { get; set; }
+		public byte CPUID { get; set; }
+
+		public WakeupEvent(BinaryReader reader) : this()
+		{
+			Start = Durable.ReadTime(reader);
+			WakerThreadID = reader.ReadUInt64();
+			WakeeThreadID = reader.ReadUInt64();
+			CPUID = reader.ReadByte();
+		}
+
+		public int CompareTo(WakeupEvent other)
+		{
+			return Start.CompareTo(other.Start);
+		}
+	}
+
+	public class WakeupBoard : IResponseHolder
+	{
+		public override DataResponse Response { get; set; }
+
+		// Wake up events grouped by the wakee thread (sorted by time)
+		public Dictionary<UInt64, List<WakeupEvent>> WakeupMap { get; set; }
+
+		// Last wake up of the thread before the timestamp (e.g. the end of the sleep interval)
+		public bool FindWakeup(UInt64 threadID, long timeStamp, out WakeupEvent result)
+		{
+			result = new WakeupEvent();
+
+			List<WakeupEvent> events = null;
+			if (WakeupMap.TryGetValue(threadID, out events))
+			{
+				int index = Utils.BinarySearchClosestIndex(events, timeStamp);
+				if (index >= 0 && events[index].Start <= timeStamp)
+				{
+					result = events[index];
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		public static WakeupBoard Create(DataResponse response, FrameGroup group)
+		{
+			WakeupBoard result = new WakeupBoard() { Response = response, WakeupMap = new Dictionary<UInt64, List<WakeupEvent>>() };
+
+			uint totalCount = response.Reader.ReadUInt32();
+			for (uint i = 0; i < totalCount; ++i)
+			{
+				WakeupEvent ev = new WakeupEvent(response.Reader);
+
+				List<WakeupEvent> events = null;
+				if (!result.WakeupMap.TryGetValue(ev.WakeeThreadID, out events))
+				{
+					events = new List<WakeupEvent>();
+					result.WakeupMap.Add(ev.WakeeThreadID, events);
+				}
+
+				events.Add(ev);
+			}
+
+			// Events come from the per-CPU buffers
+			foreach (List<WakeupEvent> events in result.WakeupMap.Values)
+				events.Sort();
+
+			return result;
+		}
+	}
+}
@@ -122,7 +122,7 @@ configuration "Debug"
 	defines { "_DEBUG", "_CRTDBG_MAP_ALLOC", "MT_INSTRUMENTED_BUILD" }
 
 configuration "linux"
-    links { "pthread" }
+    links { "pthread", "rt" }
 
 --  give each configuration/platform a unique output directory
 
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <array>
+#include <atomic>
 #include <queue>
 #include <mutex>
 #include <thread>
@@ -64,11 +65,20 @@ class MiniScheduler
 	};
 
 	std::array<Context, 4> threads;
+	std::atomic<uint64_t> jobCounter{ 0 };
 public:
 	void Add(std::function<void()> function)
 	{
+		// Linking the enqueue with the execution on the worker thread
+		uint64_t jobID = ++jobCounter;
+		OPTICK_FLOW_BEGIN(jobID, "Job");
+
 		int index = rand() % threads.size();
-		threads[index].Add(function);
+		threads[index].Add([function, jobID]
+		{
+			OPTICK_FLOW_END(jobID);
+			function();
+		});
 	}
 };
 
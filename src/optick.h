@@ -450,7 +450,7 @@ struct Mode
 		END_SCREENSHOT = (1 << 8),
 		RESERVED_0 = (1 << 9),
 		RESERVED_1 = (1 << 10),
-		// Collect HW Events
+		// Collect HW Events (CPU Frames and events marked with EventDescription::COUNT_HW_COUNTERS)
 		HW_COUNTERS = (1 << 11),
 		// Collect Events in Live mode
 		LIVE = (1 << 12),
@@ -463,6 +463,18 @@ struct Mode
 		OTHER_PROCESSES = (1 << 17),
 		// Automation
 		NOGUI = (1 << 18),
+		// Compress network dumps (see the stream flags in the Handshake response)
+		STREAM_COMPRESSION = (1 << 19),
+		// Collect thread CPU time (CPU Frames and events marked with EventDescription::COUNT_CPU_TIME)
+		CPU_TIME = (1 << 20),
+		// Sample process-level counters (memory, page faults, context switches, run-queue latency, CPU frequency)
+		SYSTEM_COUNTERS = (1 << 21),
+		// Collect allocation events (OPTICK_ALLOC\OPTICK_FREE)
+		ALLOCATIONS = (1 << 22),
+		// Attach sampled callstacks to the allocation events
+		ALLOCATION_CALLSTACKS = (1 << 23),
+		// Collect lock contention and ownership time (Optick::Mutex, OPTICK_LOCKABLE - see optick_lock.h)
+		LOCKS = (1 << 24),
 
 		TRACER = AUTOSAMPLING | SWITCH_CONTEXT | SYS_CALLS,
 		DEFAULT = INSTRUMENTATION | TAGS | AUTOSAMPLING | SWITCH_CONTEXT | IO | GPU | SYS_CALLS | OTHER_PROCESSES,
@@ -629,6 +641,11 @@ struct OPTICK_API EventDescription
 		IS_CUSTOM_NAME = 1 << 0,
 		COPY_NAME_STRING = 1 << 1,
 		COPY_FILENAME_STRING = 1 << 2,
+		// Attach hardware counters deltas (cycles, instructions, cache\branch misses) as tags (Mode::HW_COUNTERS)
+		// Example: OPTICK_EVENT("Update", Optick::Category::None, Optick::EventDescription::COUNT_HW_COUNTERS);
+		COUNT_HW_COUNTERS = 1 << 3,
+		// Attach thread CPU time spent inside the scope as a tag (Mode::CPU_TIME)
+		COUNT_CPU_TIME = 1 << 4,
 	};
 
 	const char* name;
@@ -663,6 +680,10 @@ struct OPTICK_API Event
 	static void Push(EventStorage* storage, const EventDescription* description, int64_t timestampStart);
 	static void Pop(EventStorage* storage, int64_t timestampStart);
 
+	// Async spans are matched by ID (not by stack) and could overlap arbitrarily
+	static void BeginAsync(EventStorage* storage, const EventDescription* description, uint64_t id, int64_t timestampStart);
+	static void EndAsync(EventStorage* storage, uint64_t id, int64_t timestampFinish);
+
 
 	Event(const EventDescription& description)
 	{
@@ -725,6 +746,39 @@ struct OPTICK_API Tag
 
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct OPTICK_API Counter
+{
+	// Appends a (timestamp, value) sample to the counter track of the current thread
+	static void Add(const EventDescription& description, double value);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct OPTICK_API Allocation
+{
+	static void Alloc(const void* address, size_t size);
+	static void Free(const void* address);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct OPTICK_API Lock
+{
+	// Contended acquire (the wait is added to the timeline of the current thread)
+	static void Wait(const EventDescription& description, const void* address, int64_t timestampStart, int64_t timestampFinish);
+	// Exclusive ownership of the lock
+	static void Hold(const EventDescription& description, const void* address, int64_t timestampStart, int64_t timestampFinish);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct OPTICK_API Mark
+{
+	// Zero-duration instant marker on the timeline of the current thread
+	static void Add(const EventDescription& description);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct OPTICK_API Flow
+{
+	// Links two points of the timeline (e.g. job enqueue and its execution on another thread), pairs are matched by ID
+	static void Begin(const EventDescription& description, uint64_t id);
+	static void End(const EventDescription& description, uint64_t id);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct ThreadScope
 {
     ThreadScope(const char* name)
@@ -802,6 +856,9 @@ OPTICK_API bool StopCapture(bool force = true);
 OPTICK_API bool SaveCapture(CaptureSaveChunkCb dataCb, bool force = true);
 OPTICK_API bool SaveCapture(const char* path, bool force = true);
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OPTICK_API bool AttachCollector(const char* name = nullptr);
+OPTICK_API void DetachCollector();
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct OptickApp
 {
 	const char* m_Name;
@@ -923,7 +980,7 @@ struct OptickApp
 #define OPTICK_STOP_THREAD() ::Optick::UnRegisterThread(false);
 
 // Attaches a custom data-tag.
-// Supported types: int32, uint32, uint64, vec3, string (cut to 32 characters)
+// Supported types: int32, uint32, uint64, vec3, string (up to 4096 characters, repeated values are stored once)
 // Example:
 //		OPTICK_TAG("PlayerName", name[index]);
 //		OPTICK_TAG("Health", 100);
@@ -935,6 +992,51 @@ struct OptickApp
 									if (OPTICK_CONCAT(autogen_tag_, __LINE__) == nullptr) OPTICK_CONCAT(autogen_tag_, __LINE__) = ::Optick::EventDescription::Create( NAME, __FILE__, __LINE__ ); \
 									::Optick::Tag::Attach(*OPTICK_CONCAT(autogen_tag_, __LINE__), __VA_ARGS__); \
 
+// Appends a sample to the counter track (plotted on the timeline).
+// Unlike tags, counters don't belong to any event: samples with the same NAME form a single track.
+// Counters are collected together with tags (Mode::TAGS).
+// Example:
+//		OPTICK_COUNTER("Allocated MB", allocatedBytes / (1024.0 * 1024.0));
+//		OPTICK_COUNTER("Job Queue", queue.size());
+#define OPTICK_COUNTER(NAME, VALUE)	static ::Optick::EventDescription* OPTICK_CONCAT(autogen_counter_, __LINE__) = nullptr; \
+									if (OPTICK_CONCAT(autogen_counter_, __LINE__) == nullptr) OPTICK_CONCAT(autogen_counter_, __LINE__) = ::Optick::EventDescription::CreateShared( NAME, __FILE__, __LINE__ ); \
+									::Optick::Counter::Add(*OPTICK_CONCAT(autogen_counter_, __LINE__), (double)(VALUE));
+
+// Zero-duration instant marker (e.g. "Message Received").
+// Stored as (timestamp, description index) - half the size of an empty event, no enclosing scope is required.
+// Example:
+//		OPTICK_MARK("Message Received");
+#define OPTICK_MARK(NAME)			static ::Optick::EventDescription* OPTICK_CONCAT(autogen_mark_, __LINE__) = nullptr; \
+									if (OPTICK_CONCAT(autogen_mark_, __LINE__) == nullptr) OPTICK_CONCAT(autogen_mark_, __LINE__) = ::Optick::EventDescription::Create( NAME, __FILE__, __LINE__ ); \
+									::Optick::Mark::Add(*OPTICK_CONCAT(autogen_mark_, __LINE__));
+
+// Memory allocation tracking (Mode::ALLOCATIONS).
+// Records allocation events of the current thread, Mode::ALLOCATION_CALLSTACKS adds sampled callstacks.
+// Only the threads registered in Optick are tracked.
+// Example:
+//		void* MyAlloc(size_t size) { void* ptr = malloc(size); OPTICK_ALLOC(ptr, size); return ptr; }
+//		void MyFree(void* ptr) { OPTICK_FREE(ptr); free(ptr); }
+// Notes:
+//		Linux applications could be tracked without any code changes: LD_PRELOAD=liboptick-malloc-shim.so ./app
+#define OPTICK_ALLOC(PTR, SIZE)		::Optick::Allocation::Alloc(PTR, SIZE);
+#define OPTICK_FREE(PTR)			::Optick::Allocation::Free(PTR);
+
+// Cross-thread flow events (e.g. for job systems).
+// OPTICK_FLOW_BEGIN marks the job enqueue, OPTICK_FLOW_END marks the start of its execution (matched by ID).
+// Optional name of the BEGIN marker defines the job type for queue latency statistics in the summary (function name by default).
+// Example:
+//		uint64_t id = ++jobCounter;
+//		OPTICK_FLOW_BEGIN(id, "Physics Job");
+//		queue.push([=] { OPTICK_FLOW_END(id); ... });
+// Notes:
+//		Both threads have to be registered in Optick (OPTICK_THREAD).
+#define OPTICK_FLOW_BEGIN(ID, ...)	static ::Optick::EventDescription* OPTICK_CONCAT(autogen_flow_, __LINE__) = nullptr; \
+									if (OPTICK_CONCAT(autogen_flow_, __LINE__) == nullptr) OPTICK_CONCAT(autogen_flow_, __LINE__) = ::Optick::CreateDescription(OPTICK_FUNC, __FILE__, __LINE__, ##__VA_ARGS__); \
+									::Optick::Flow::Begin(*OPTICK_CONCAT(autogen_flow_, __LINE__), (uint64_t)(ID));
+#define OPTICK_FLOW_END(ID, ...)	static ::Optick::EventDescription* OPTICK_CONCAT(autogen_flow_, __LINE__) = nullptr; \
+									if (OPTICK_CONCAT(autogen_flow_, __LINE__) == nullptr) OPTICK_CONCAT(autogen_flow_, __LINE__) = ::Optick::CreateDescription(OPTICK_FUNC, __FILE__, __LINE__, ##__VA_ARGS__); \
+									::Optick::Flow::End(*OPTICK_CONCAT(autogen_flow_, __LINE__), (uint64_t)(ID));
+
 // Scoped macro with DYNAMIC name.
 // Optick holds a copy of the provided name.
 // Each scope does a search in hashmap for the name.
@@ -1000,6 +1102,20 @@ struct OptickApp
 #define OPTICK_STORAGE_PUSH(STORAGE, DESCRIPTION, CPU_TIMESTAMP_START)							if (::Optick::IsActive()) { ::Optick::Event::Push(STORAGE, DESCRIPTION, CPU_TIMESTAMP_START); }
 #define OPTICK_STORAGE_POP(STORAGE, CPU_TIMESTAMP_FINISH)										if (::Optick::IsActive()) { ::Optick::Event::Pop(STORAGE, CPU_TIMESTAMP_FINISH); }
 
+// Async spans in the custom storage (e.g. in-flight I/O requests, network requests, GPU uploads).
+// Unlike PUSH\POP, spans are paired by ID and don't need to be nested.
+// Overlapping spans are packed into non-overlapping lanes (sub-tracks of the storage) during the dump.
+// Example:
+//			OPTICK_STORAGE_ASYNC_BEGIN(IOStorage, IORead, request.id, Optick::GetHighPrecisionTime());
+//			...
+//			// Completion callback
+//			OPTICK_STORAGE_ASYNC_END(IOStorage, request.id, Optick::GetHighPrecisionTime());
+// Notes:
+//		The same thread-safety rules as for OPTICK_STORAGE_EVENT.
+//		Spans which are not finished by the end of the capture are skipped.
+#define OPTICK_STORAGE_ASYNC_BEGIN(STORAGE, DESCRIPTION, ID, CPU_TIMESTAMP_START)				if (::Optick::IsActive()) { ::Optick::Event::BeginAsync(STORAGE, DESCRIPTION, ID, CPU_TIMESTAMP_START); }
+#define OPTICK_STORAGE_ASYNC_END(STORAGE, ID, CPU_TIMESTAMP_FINISH)								if (::Optick::IsActive()) { ::Optick::Event::EndAsync(STORAGE, ID, CPU_TIMESTAMP_FINISH); }
+
 
 // Registers state change callback
 // If callback returns false - the call is repeated the next frame
@@ -1065,6 +1181,14 @@ struct OptickApp
 //		OPTICK_SAVE_CAPTURE("ConsoleApp.opt");
 #define OPTICK_SAVE_CAPTURE(...)				::Optick::SaveCapture(__VA_ARGS__);
 
+// Attaches to a running optick-collector process
+// OPTICK_SAVE_CAPTURE(path) streams raw capture data through the shared memory and the collector does compression and disk writes
+// Params:
+//		[Optional] const char* name - name of the shared memory segment (default: "/optick-collector")
+// Example:
+//		OPTICK_ATTACH_COLLECTOR();
+#define OPTICK_ATTACH_COLLECTOR(...)			::Optick::AttachCollector(__VA_ARGS__);
+
 // Generate a capture for the whole scope
 // Params:
 //		NAME - name of the application
@@ -1086,6 +1210,12 @@ struct OptickApp
 #define OPTICK_START_THREAD(THREAD_NAME)
 #define OPTICK_STOP_THREAD()
 #define OPTICK_TAG(NAME, DATA)
+#define OPTICK_COUNTER(NAME, VALUE)
+#define OPTICK_MARK(NAME)
+#define OPTICK_ALLOC(PTR, SIZE)
+#define OPTICK_FREE(PTR)
+#define OPTICK_FLOW_BEGIN(ID, ...)
+#define OPTICK_FLOW_END(ID, ...)
 #define OPTICK_EVENT_DYNAMIC(NAME)	
 #define OPTICK_PUSH_DYNAMIC(NAME)		
 #define OPTICK_PUSH(NAME)				
@@ -1095,6 +1225,8 @@ struct OptickApp
 #define OPTICK_STORAGE_EVENT(STORAGE, DESCRIPTION, CPU_TIMESTAMP_START, CPU_TIMESTAMP_FINISH)
 #define OPTICK_STORAGE_PUSH(STORAGE, DESCRIPTION, CPU_TIMESTAMP_START)
 #define OPTICK_STORAGE_POP(STORAGE, CPU_TIMESTAMP_FINISH)				
+#define OPTICK_STORAGE_ASYNC_BEGIN(STORAGE, DESCRIPTION, ID, CPU_TIMESTAMP_START)
+#define OPTICK_STORAGE_ASYNC_END(STORAGE, ID, CPU_TIMESTAMP_FINISH)
 #define OPTICK_SET_STATE_CHANGED_CALLBACK(CALLBACK)
 #define OPTICK_SET_MEMORY_ALLOCATOR(ALLOCATE_FUNCTION, DEALLOCATE_FUNCTION)	
 #define OPTICK_SHUTDOWN()
@@ -1109,5 +1241,6 @@ struct OptickApp
 #define OPTICK_START_CAPTURE(...)
 #define OPTICK_STOP_CAPTURE()
 #define OPTICK_SAVE_CAPTURE(...)
+#define OPTICK_ATTACH_COLLECTOR(...)
 #define OPTICK_APP(NAME)
 #endif
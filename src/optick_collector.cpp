@@ -0,0 +1,360 @@
+// The MIT License(MIT)
+//
+// Copyright(c) 2019 Vadim Slyusarev
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "optick_collector.h"
+
+#if USE_OPTICK
+#include "optick_memory.h"
+
+#include <algorithm>
+
+#if OPTICK_ENABLE_COLLECTOR
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Optick
+{
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* CollectorChannel::DEFAULT_NAME = "/optick-collector";
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CollectorChannel::Header
+{
+	static const uint32 MAGIC = 0xB50FC011u;
+	static const uint32 VERSION = 1;
+
+	uint32 magic;
+	uint32 version;
+	uint64 capacity;
+
+	std::atomic<uint64> writePosition;
+	std::atomic<uint64> readPosition;
+
+	std::atomic<int32> collectorPid;
+	std::atomic<int32> producerPid;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const size_t COLLECTOR_HEADER_SIZE = 128;
+static const int COLLECTOR_WAIT_US = 500;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CollectorChannel::CollectorChannel() : header(nullptr), data(nullptr), mappedSize(0), isOwner(false), scratch(nullptr), scratchSize(0)
+{
+	static_assert(sizeof(Header) <= COLLECTOR_HEADER_SIZE, "Collector header doesn't fit");
+	name[0] = 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CollectorChannel::~CollectorChannel()
+{
+	Close();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CollectorChannel::CopyIn(uint64 position, const void* src, size_t size)
+{
+	size_t offset = (size_t)(position % header->capacity);
+	size_t head = std::min(size, (size_t)header->capacity - offset);
+	memcpy(data + offset, src, head);
+	if (head < size)
+		memcpy(data, (const uint8*)src + head, size - head);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CollectorChannel::CopyOut(uint64 position, void* dst, size_t size) const
+{
+	size_t offset = (size_t)(position % header->capacity);
+	size_t head = std::min(size, (size_t)header->capacity - offset);
+	memcpy(dst, data + offset, head);
+	if (head < size)
+		memcpy((uint8*)dst + head, data, size - head);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if OPTICK_ENABLE_COLLECTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool IsProcessAlive(int32 pid)
+{
+	if (pid <= 0)
+		return false;
+
+	return kill(pid, 0) == 0 || errno == EPERM;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CollectorChannel::Create(const char* channelName, size_t capacity)
+{
+	Close();
+
+	strncpy(name, channelName, sizeof(name) - 1);
+	name[sizeof(name) - 1] = 0;
+
+	// Removing a stale segment of a crashed collector
+	shm_unlink(name);
+
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		return false;
+
+	size_t size = COLLECTOR_HEADER_SIZE + capacity;
+	if (ftruncate(fd, (off_t)size) != 0)
+	{
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+
+	void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (memory == MAP_FAILED)
+	{
+		shm_unlink(name);
+		return false;
+	}
+
+	mappedSize = size;
+	isOwner = true;
+	data = (uint8*)memory + COLLECTOR_HEADER_SIZE;
+	header = new (memory) Header();
+	header->magic = Header::MAGIC;
+	header->version = Header::VERSION;
+	header->capacity = capacity;
+	header->writePosition.store(0);
+	header->readPosition.store(0);
+	header->producerPid.store(0);
+	header->collectorPid.store((int32)getpid());
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CollectorChannel::Open(const char* channelName)
+{
+	Close();
+
+	int fd = shm_open(channelName, O_RDWR, 0600);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size <= COLLECTOR_HEADER_SIZE)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* memory = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (memory == MAP_FAILED)
+		return false;
+
+	Header* channel = (Header*)memory;
+	int32 producer = channel->producerPid.load();
+
+	bool isValid = channel->magic == Header::MAGIC
+				&& channel->version == Header::VERSION
+				&& channel->capacity + COLLECTOR_HEADER_SIZE == (uint64)info.st_size
+				&& IsProcessAlive(channel->collectorPid.load())
+				&& !IsProcessAlive(producer)
+				&& channel->producerPid.compare_exchange_strong(producer, (int32)getpid());
+
+	if (!isValid)
+	{
+		munmap(memory, (size_t)info.st_size);
+		return false;
+	}
+
+	strncpy(name, channelName, sizeof(name) - 1);
+	name[sizeof(name) - 1] = 0;
+
+	mappedSize = (size_t)info.st_size;
+	isOwner = false;
+	header = channel;
+	data = (uint8*)memory + COLLECTOR_HEADER_SIZE;
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CollectorChannel::Close()
+{
+	if (header == nullptr)
+		return;
+
+	if (isOwner)
+	{
+		header->collectorPid.store(0);
+		munmap(header, mappedSize);
+		shm_unlink(name);
+	}
+	else
+	{
+		header->producerPid.store(0);
+		munmap(header, mappedSize);
+	}
+
+	if (scratch)
+	{
+		Memory::Free(scratch);
+		scratch = nullptr;
+		scratchSize = 0;
+	}
+
+	header = nullptr;
+	data = nullptr;
+	mappedSize = 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CollectorChannel::IsPeerAlive() const
+{
+	if (header == nullptr)
+		return false;
+
+	return IsProcessAlive(isOwner ? header->producerPid.load() : header->collectorPid.load());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CollectorChannel::Write(const CollectorRecord& record, const char* payload)
+{
+	if (header == nullptr)
+		return false;
+
+	uint64 total = sizeof(CollectorRecord) + record.size;
+	OPTICK_VERIFY(total <= header->capacity, "Collector record is bigger than the channel", return false);
+
+	uint64 writePosition = header->writePosition.load(std::memory_order_relaxed);
+
+	// The collector is normally much faster than we are, so simply wait for the free space
+	while (header->capacity - (writePosition - header->readPosition.load(std::memory_order_acquire)) < total)
+	{
+		if (!IsPeerAlive())
+			return false;
+
+		usleep(COLLECTOR_WAIT_US);
+	}
+
+	CopyIn(writePosition, &record, sizeof(CollectorRecord));
+	if (record.size > 0)
+		CopyIn(writePosition + sizeof(CollectorRecord), payload, record.size);
+
+	header->writePosition.store(writePosition + total, std::memory_order_release);
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CollectorChannel::Read(ReadCb cb, void* context)
+{
+	if (header == nullptr)
+		return 0;
+
+	uint64 readPosition = header->readPosition.load(std::memory_order_relaxed);
+	uint64 writePosition = header->writePosition.load(std::memory_order_acquire);
+
+	size_t bytesRead = 0;
+
+	while (readPosition < writePosition)
+	{
+		CollectorRecord record;
+		CopyOut(readPosition, &record, sizeof(CollectorRecord));
+
+		if (record.size > scratchSize)
+		{
+			Memory::Free(scratch);
+			scratchSize = record.size;
+			scratch = (char*)Memory::Alloc(scratchSize);
+		}
+
+		if (record.size > 0)
+			CopyOut(readPosition + sizeof(CollectorRecord), scratch, record.size);
+
+		cb(context, (CollectorRecord::Type)record.type, scratch, record.size);
+
+		uint64 total = sizeof(CollectorRecord) + record.size;
+		readPosition += total;
+		bytesRead += (size_t)total;
+
+		header->readPosition.store(readPosition, std::memory_order_release);
+	}
+
+	return bytesRead;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CollectorChannel::Begin(const char* path)
+{
+	char fullPath[PATH_MAX] = { 0 };
+
+	// The collector might be running in a different working directory
+	if (path[0] != '/' && getcwd(fullPath, sizeof(fullPath)) != nullptr)
+	{
+		size_t length = strlen(fullPath);
+		snprintf(fullPath + length, sizeof(fullPath) - length, "/%s", path);
+	}
+	else
+	{
+		strncpy(fullPath, path, sizeof(fullPath) - 1);
+	}
+
+	CollectorRecord record = { CollectorRecord::Start, (uint32)strlen(fullPath) };
+	return Write(record, fullPath);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CollectorChannel::Write(const char* payload, size_t size)
+{
+	if (header == nullptr)
+		return false;
+
+	// Splitting big chunks, so that the collector could work in parallel with us
+	// The collector glues the parts back to keep compression output identical to SaveCapture
+	const size_t maxChunkSize = (size_t)(header->capacity / 4);
+
+	while (size > 0)
+	{
+		size_t chunkSize = std::min(size, maxChunkSize);
+
+		CollectorRecord record = { chunkSize < size ? CollectorRecord::DataPart : CollectorRecord::Data, (uint32)chunkSize };
+		if (!Write(record, payload))
+			return false;
+
+		payload += chunkSize;
+		size -= chunkSize;
+	}
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CollectorChannel::Finish()
+{
+	CollectorRecord record = { CollectorRecord::Finish, 0 };
+	return Write(record, nullptr);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#else
+bool CollectorChannel::Create(const char* /*name*/, size_t /*capacity*/) { return false; }
+bool CollectorChannel::Open(const char* /*name*/) { return false; }
+void CollectorChannel::Close() {}
+bool CollectorChannel::IsPeerAlive() const { return false; }
+bool CollectorChannel::Write(const CollectorRecord& /*record*/, const char* /*payload*/) { return false; }
+size_t CollectorChannel::Read(ReadCb /*cb*/, void* /*context*/) { return 0; }
+bool CollectorChannel::Begin(const char* /*path*/) { return false; }
+bool CollectorChannel::Write(const char* /*payload*/, size_t /*size*/) { return false; }
+bool CollectorChannel::Finish() { return false; }
+#endif
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+#endif //USE_OPTICK
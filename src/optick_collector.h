@@ -0,0 +1,98 @@
+// The MIT License(MIT)
+//
+// Copyright(c) 2019 Vadim Slyusarev
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include "optick.config.h"
+
+#if USE_OPTICK
+#include "optick_common.h"
+
+#if defined(OPTICK_LINUX) || defined(OPTICK_OSX) || defined(OPTICK_FREEBSD)
+#define OPTICK_ENABLE_COLLECTOR (1)
+#else
+#define OPTICK_ENABLE_COLLECTOR (0)
+#endif
+
+namespace Optick
+{
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Record header of the collector channel (followed by 'size' bytes of payload)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CollectorRecord
+{
+	enum Type : uint32
+	{
+		Start,		// payload: absolute path of the output capture file
+		Data,		// payload: raw (uncompressed) capture stream
+		DataPart,	// payload: beginning of a big Data chunk which doesn't fit into the channel (continued by the next record)
+		Finish,		// payload: empty
+	};
+
+	uint32 type;
+	uint32 size;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Single producer \ single consumer byte ring in a named shared memory segment.
+// The segment is created by the optick-collector process and opened by the profiled application.
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class OPTICK_API CollectorChannel
+{
+	struct Header;
+
+	Header* header;
+	uint8* data;
+	size_t mappedSize;
+	bool isOwner;
+	char name[256];
+
+	char* scratch;
+	size_t scratchSize;
+
+	void CopyIn(uint64 position, const void* src, size_t size);
+	void CopyOut(uint64 position, void* dst, size_t size) const;
+	bool Write(const CollectorRecord& record, const char* payload);
+public:
+	static const char* DEFAULT_NAME;
+	static const size_t DEFAULT_CAPACITY = 64 << 20; // 64Mb
+
+	CollectorChannel();
+	~CollectorChannel();
+
+	// Collector side
+	bool Create(const char* name, size_t capacity);
+	typedef void(*ReadCb)(void* context, CollectorRecord::Type type, const char* data, size_t size);
+	size_t Read(ReadCb cb, void* context);
+
+	// Profiled application side
+	bool Open(const char* name);
+	bool Begin(const char* path);
+	bool Write(const char* data, size_t size);
+	bool Finish();
+
+	bool IsOpen() const { return header != nullptr; }
+	bool IsPeerAlive() const;
+	void Close();
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+#endif //USE_OPTICK
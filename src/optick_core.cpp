@@ -65,6 +65,7 @@ namespace Optick
 void* (*Memory::allocate)(size_t) = [](size_t size)->void* { return operator new(size); };
 void (*Memory::deallocate)(void* p) = [](void* p) { operator delete(p); };
 void (*Memory::initThread)(void) = nullptr;
+OPTICK_THREAD_LOCAL uint32_t Memory::internalCallDepth = 0;
 #if defined(OPTICK_32BIT)
 	std::atomic<uint32_t> Memory::memAllocated;
 #else
@@ -192,6 +193,11 @@ OutputDataStream& operator<<(OutputDataStream& stream, const TagData<T>& ob)
 	return stream << ob.timestamp << ob.description->index << ob.data;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const MarkData& ob)
+{
+	return stream << (int64)ob.timestamp << (uint32)ob.descriptionIndex;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 OutputDataStream& operator<<(OutputDataStream& os, const Symbol * const symbol)
 {
 	OPTICK_VERIFY(symbol, "Can't serialize NULL symbol!", return os);
@@ -252,15 +258,27 @@ EventData* Event::Start(const EventDescription& description)
 		result = &storage->NextEvent();
 		result->description = &description;
 		result->Start();
+
+		if (description.flags & EventDescription::COUNT_HW_COUNTERS)
+			storage->PushHWCounters();
+
+		if (description.flags & EventDescription::COUNT_CPU_TIME)
+			storage->PushCPUTime();
 	}
 	return result;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Event::Stop(EventData& data)
 {
-	if (Core::storage != nullptr)
+	if (EventStorage* storage = Core::storage)
 	{
 		data.Stop();
+
+		if (data.description->flags & EventDescription::COUNT_HW_COUNTERS)
+			storage->PopHWCounters(data);
+
+		if (data.description->flags & EventDescription::COUNT_CPU_TIME)
+			storage->PopCPUTime(data);
 	}
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -324,6 +342,34 @@ void Event::Pop(EventStorage* storage, int64_t timestampFinish)
 	PopEvent(storage, timestampFinish);
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Event::BeginAsync(EventStorage* storage, const EventDescription* description, uint64_t id, int64_t timestampStart)
+{
+	if (storage)
+	{
+		AsyncEventData& data = storage->asyncEventBuffer.Add();
+		data.description = description;
+		data.start = timestampStart;
+		data.finish = EventTime::INVALID_TIMESTAMP;
+		data.id = id;
+
+		// Reused ID - the previous span is left unfinished
+		storage->asyncEventsInFlight[id] = &data;
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Event::EndAsync(EventStorage* storage, uint64_t id, int64_t timestampFinish)
+{
+	if (storage)
+	{
+		auto it = storage->asyncEventsInFlight.find(id);
+		if (it != storage->asyncEventsInFlight.end())
+		{
+			it->second->finish = timestampFinish;
+			storage->asyncEventsInFlight.erase(it);
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 EventData* GPUEvent::Start(const EventDescription& description)
 {
 	EventData* result = nullptr;
@@ -401,14 +447,167 @@ void Tag::Attach(const EventDescription& description, const char* val)
 {
 	if (EventStorage* storage = Core::storage)
 		if (storage->currentMode & Mode::TAGS)
-			storage->tagStringBuffer.Add(TagString(description, val));
+		{
+			const char* text = val ? val : "null";
+			storage->tagStringBuffer.Add(TagString(description, storage->tagStringArena.Add(text, (uint32)strlen(text))));
+		}
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Tag::Attach(const EventDescription& description, const char* val, uint16_t length)
 {
 	if (EventStorage * storage = Core::storage)
 		if (storage->currentMode & Mode::TAGS)
-			storage->tagStringBuffer.Add(TagString(description, val, length));
+		{
+			if (val == nullptr)
+				Attach(description, val);
+			else
+				storage->tagStringBuffer.Add(TagString(description, storage->tagStringArena.Add(val, (uint32)strnlen(val, length))));
+		}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+StringRef TagStringArena::Add(const char* text, uint32 length)
+{
+	if (length > MAX_LENGTH)
+		length = MAX_LENGTH;
+
+	StringHash hash(MurmurHash64A(text, (int)length, 0));
+
+	auto it = internTable.find(hash);
+	if (it != internTable.end() && it->second.ref.length == length && memcmp(it->second.data, text, length) == 0)
+		return it->second.ref;
+
+	StringRef ref = { size, length };
+
+	if (length > 0)
+	{
+		// MemoryBuffer starts a new chunk if the string doesn't fit into the current one
+		uint32 chunkLeft = CHUNK_SIZE - (size % CHUNK_SIZE);
+		if (length >= chunkLeft)
+			ref.offset = size + chunkLeft;
+
+		const char* data = buffer.Add(text, length, false);
+		size = ref.offset + length;
+
+		if (internTable.size() < MAX_INTERNED_COUNT)
+			internTable[hash] = Entry{ ref, data };
+	}
+
+	return ref;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TagStringArena::Clear(bool preserveMemory)
+{
+	buffer.Clear(preserveMemory);
+	internTable.clear();
+	size = 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const StringRef& ob)
+{
+	return stream << ob.offset << ob.length;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const TagStringArena& ob)
+{
+	OPTICK_ASSERT(ob.size == ob.buffer.Size() || ob.size == 0, "TagStringArena is out of sync with the MemoryBuffer");
+
+	stream << ob.size;
+	ob.buffer.ForEachChunk([&](const uint8* data, uint32 count)
+	{
+		stream.Write((const char*)data, count);
+	});
+	return stream;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Counter::Add(const EventDescription& description, double value)
+{
+	if (EventStorage* storage = Core::storage)
+		if (storage->currentMode & Mode::TAGS)
+			storage->counterBuffer.Add(CounterSample(description, value));
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Mark::Add(const EventDescription& description)
+{
+	if (EventStorage* storage = Core::storage)
+	{
+		MarkData& data = storage->markBuffer.Add();
+		data.timestamp = GetHighPrecisionTime();
+		data.descriptionIndex = description.index;
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Allocation::Alloc(const void* address, size_t size)
+{
+	if (EventStorage* storage = Core::storage)
+		if ((storage->currentMode & Mode::ALLOCATIONS) && address != nullptr && !Memory::IsInternalCall())
+			storage->AddAllocation(address, (uint64)size, AllocationData::ALLOC);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Allocation::Free(const void* address)
+{
+	if (EventStorage* storage = Core::storage)
+		if ((storage->currentMode & Mode::ALLOCATIONS) && address != nullptr && !Memory::IsInternalCall())
+			storage->AddAllocation(address, 0, AllocationData::FREE);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Lock::Wait(const EventDescription& description, const void* address, int64_t timestampStart, int64_t timestampFinish)
+{
+	if (EventStorage* storage = Core::storage)
+	{
+		if (storage->currentMode & Mode::LOCKS)
+		{
+			// The thread was blocked - nothing else could be recorded in between, so the order of the events is preserved
+			Event::Add(storage, &description, timestampStart, timestampFinish);
+
+			LockData& data = storage->lockBuffer.Add();
+			data.start = timestampStart;
+			data.finish = timestampFinish;
+			data.description = &description;
+			data.address = (uint64)address;
+			data.type = LockData::WAIT;
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Lock::Hold(const EventDescription& description, const void* address, int64_t timestampStart, int64_t timestampFinish)
+{
+	if (EventStorage* storage = Core::storage)
+	{
+		if (storage->currentMode & Mode::LOCKS)
+		{
+			LockData& data = storage->lockBuffer.Add();
+			data.start = timestampStart;
+			data.finish = timestampFinish;
+			data.description = &description;
+			data.address = (uint64)address;
+			data.type = LockData::HOLD;
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void AddFlow(const EventDescription& description, uint64_t id, FlowData::Type type)
+{
+	if (EventStorage* storage = Core::storage)
+	{
+		if (storage->currentMode & Mode::INSTRUMENTATION)
+		{
+			FlowData& data = storage->flowBuffer.Add();
+			data.timestamp = GetHighPrecisionTime();
+			data.id = id;
+			data.description = &description;
+			data.type = type;
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Flow::Begin(const EventDescription& description, uint64_t id)
+{
+	AddFlow(description, id, FlowData::BEGIN);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Flow::End(const EventDescription& description, uint64_t id)
+{
+	AddFlow(description, id, FlowData::END);
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 OutputDataStream & operator<<(OutputDataStream &stream, const EventDescription &ob)
@@ -568,39 +767,230 @@ bool SysCallCollector::Serialize(OutputDataStream& stream)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void CallstackCollector::Add(const CallstackDesc& desc)
+SymbolCache::~SymbolCache()
 {
-	if (uint64* storage = callstacksPool.TryAdd(desc.count + 3))
+	Clear();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SymbolCache::Begin(const vector<Module>& modules)
+{
+	++generation;
+	moduleRanges.clear();
+
+	for (const Module& module : modules)
 	{
-		storage[0] = desc.threadID;
-		storage[1] = desc.timestamp;
-		storage[2] = desc.count;
+		// Same path and size => the same image (which might be loaded at a different address)
+		size_t index = 0;
+		while (index < knownModules.size() && (knownModules[index].size != module.size || knownModules[index].path != module.path))
+			++index;
 
-		for (uint64 i = 0; i < desc.count; ++i)
+		if (index == knownModules.size())
 		{
-			storage[3 + i] = desc.callstack[desc.count - i - 1];
+			ModuleDesc desc;
+			desc.path = module.path;
+			desc.size = module.size;
+			knownModules.push_back(desc);
 		}
+
+		ModuleRange range;
+		range.begin = (uint64)module.address;
+		range.end = range.begin + module.size;
+		range.key = (uint64)(index + 1) << MODULE_KEY_SHIFT;
+		moduleRanges.push_back(range);
+	}
+
+	std::sort(moduleRanges.begin(), moduleRanges.end());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SymbolCache::GetKey(uint64 address, uint64& key) const
+{
+	ModuleRange range;
+	range.begin = address;
+	auto it = std::upper_bound(moduleRanges.begin(), moduleRanges.end(), range);
+	if (it == moduleRanges.begin())
+		return false;
+
+	--it;
+	uint64 offset = address - it->begin;
+	if (address >= it->end || offset >= ((uint64)1 << MODULE_KEY_SHIFT))
+		return false;
+
+	key = it->key | offset;
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const Symbol* SymbolCache::Find(uint64 address)
+{
+	uint64 key = 0;
+	if (!GetKey(address, key))
+		return nullptr;
+
+	auto it = entries.find(key);
+	if (it == entries.end())
+		return nullptr;
+
+	Entry& entry = it->second;
+
+	// The same module is mapped twice
+	if (entry.generation == generation && entry.symbol->address != address)
+		return nullptr;
+
+	entry.generation = generation;
+	entry.symbol->address = address;
+	return entry.symbol;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const Symbol* SymbolCache::Add(const Symbol& symbol)
+{
+	uint64 key = 0;
+	if (!GetKey(symbol.address, key))
+		return &symbol;
+
+	Entry& entry = entries[key];
+	if (entry.symbol == nullptr)
+	{
+		entry.symbol = Memory::New<Symbol>();
+	}
+	else if (entry.generation == generation)
+	{
+		// The key is already used by another address in this capture
+		return &symbol;
 	}
 	else
 	{
-		uint64& item0 = callstacksPool.Add();
-		uint64& item1 = callstacksPool.Add();
-		uint64& item2 = callstacksPool.Add();
+		memorySize -= entry.memorySize;
+	}
 
-		item0 = desc.threadID;
-		item1 = desc.timestamp;
-		item2 = desc.count;
+	*entry.symbol = symbol;
+	entry.generation = generation;
+	entry.memorySize = sizeof(Entry) + sizeof(Symbol) + (symbol.function.capacity() + symbol.file.capacity()) * sizeof(wchar_t);
+	memorySize += entry.memorySize;
 
-		for (uint64 i = 0; i < desc.count; ++i)
+	return entry.symbol;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SymbolCache::Trim()
+{
+	for (int pass = 0; pass < 2 && memorySize > MAX_MEMORY_SIZE; ++pass)
+	{
+		// First pass - evicting stale symbols only, second pass - everything until we fit into the budget
+		for (auto it = entries.begin(); it != entries.end() && memorySize > MAX_MEMORY_SIZE;)
 		{
-			callstacksPool.Add() = desc.callstack[desc.count - i - 1];
+			if (pass == 1 || it->second.generation != generation)
+			{
+				memorySize -= it->second.memorySize;
+				Memory::Delete(it->second.symbol);
+				it = entries.erase(it);
+			}
+			else
+			{
+				++it;
+			}
 		}
 	}
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SymbolCache::Clear()
+{
+	for (auto it = entries.begin(); it != entries.end(); ++it)
+		Memory::Delete(it->second.symbol);
+
+	entries.clear();
+	knownModules.clear();
+	moduleRanges.clear();
+	memorySize = 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OPTICK_INLINE size_t CallstackTree::GetHash(uint32 parent, uint64 address)
+{
+	uint64 hash = (address ^ ((uint64)parent << 32 | parent)) * 0x9E3779B97F4A7C15ull;
+	return (size_t)(hash ^ (hash >> 29));
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CallstackTree::Rehash(size_t bucketCount)
+{
+	buckets.clear();
+	buckets.resize(bucketCount, 0);
+
+	for (uint32 index = 1; index < (uint32)nodes.size(); ++index)
+	{
+		Node& node = nodes[index];
+		uint32& bucket = buckets[GetHash(node.parent, node.address) & (bucketCount - 1)];
+		node.next = bucket;
+		bucket = index;
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32 CallstackTree::Add(uint32 parent, uint64 address)
+{
+	if (nodes.empty())
+	{
+		Node root = { 0, ROOT, 0 };
+		nodes.push_back(root);
+		Rehash(1024);
+	}
+
+	uint32& bucket = buckets[GetHash(parent, address) & (buckets.size() - 1)];
+	for (uint32 index = bucket; index != 0; index = nodes[index].next)
+	{
+		const Node& node = nodes[index];
+		if (node.address == address && node.parent == parent)
+			return index;
+	}
+
+	uint32 index = (uint32)nodes.size();
+	Node node = { address, parent, bucket };
+	nodes.push_back(node);
+	bucket = index;
+
+	if (nodes.size() > buckets.size())
+		Rehash(buckets.size() * 2);
+
+	return index;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CallstackTree::Clear()
+{
+	// Releasing the memory (tree might be huge after a long capture)
+	vector<Node>().swap(nodes);
+	vector<uint32>().swap(buckets);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const CallstackTree& ob)
+{
+	// {NodeCount, NodeCount x {ParentIndex, Address}}, parent always precedes its children
+	stream << (uint32)ob.Size();
+	for (size_t index = 1; index < ob.nodes.size(); ++index)
+		stream << ob.nodes[index].parent << ob.nodes[index].address;
+	return stream;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const CallstackSample& ob)
+{
+	return stream << ob.threadID << ob.timestamp << ob.stackID;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CallstackCollector::Add(const CallstackDesc& desc)
+{
+	CallstackSample& sample = samplesPool.Add();
+	sample.threadID = desc.threadID;
+	sample.timestamp = desc.timestamp;
+	sample.stackID = AddCallstack(desc.callstack, desc.count);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32 CallstackCollector::AddCallstack(const uint64* callstack, uint32 count)
+{
+	// Callstack is stored from leaf to root, the tree is built from the root
+	uint32 node = CallstackTree::ROOT;
+	for (int i = (int)count - 1; i >= 0; --i)
+		node = callstackTree.Add(node, callstack[i]);
+	return node;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void CallstackCollector::Clear()
 {
-	callstacksPool.Clear(false);
+	samplesPool.Clear(false);
+	callstackTree.Clear();
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool CallstackCollector::SerializeModules(OutputDataStream& stream)
@@ -624,39 +1014,12 @@ bool CallstackCollector::SerializeSymbols(OutputDataStream& stream)
 
 	Core::Get().DumpProgress("Collecting Callstacks...");
 
-	for (CallstacksPool::const_iterator it = callstacksPool.begin(); it != callstacksPool.end();)
+	// Every unique frame is stored in the tree only once
+	for (uint32 node = 1; node <= (uint32)callstackTree.Size(); ++node)
 	{
-		CallstacksPool::const_iterator startIt = it;
-		OPTICK_UNUSED(startIt);
-
-		uint64 threadID = *it;
-		OPTICK_UNUSED(threadID);
-		++it; //Skip ThreadID
-		uint64 timestamp = *it;
-		OPTICK_UNUSED
-		(timestamp);
-		++it; //Skip Timestamp
-		uint64 count = *it;
-		count = (count & 0xFF);
-		++it; //Skip Count
-
-		bool isBadAddrFound = false;
-
-		for (uint64 i = 0; i < count; ++i)
-		{
-			uint64 address = *it;
-			++it;
-
-			if (address == 0)
-			{
-				isBadAddrFound = true;
-			}
-
-			if (!isBadAddrFound)
-			{
-				symbolSet.insert(address);
-			}
-		}
+		uint64 address = callstackTree.GetAddress(node);
+		if (address != 0)
+			symbolSet.insert(address);
 	}
 
 	SymbolEngine* symEngine = Core::Get().symbolEngine;
@@ -668,34 +1031,40 @@ bool CallstackCollector::SerializeSymbols(OutputDataStream& stream)
 
 	if (symEngine)
 	{
-		int total = (int)symbolSet.size();
-		const int progressBatchSize = 100;
+		symbolCache.Begin(symEngine->GetModules());
+
+		vector<uint64> unresolved;
 		for (auto it = symbolSet.begin(); it != symbolSet.end(); ++it)
 		{
-			uint64 address = *it;
-			if (const Symbol* symbol = symEngine->GetSymbol(address))
-			{
+			if (const Symbol* symbol = symbolCache.Find(*it))
 				symbols.push_back(symbol);
-
-				if ((symbols.size() % progressBatchSize == 0) && Core::Get().IsTimeToReportProgress())
-				{
-					Core::Get().DumpProgressFormatted("Resolving addresses %d / %d", (int)symbols.size(), total);
-				}
-			}
+			else
+				unresolved.push_back(*it);
 		}
+
+		Core::Get().DumpProgressFormatted("Resolving addresses %d (cached %d)", (int)unresolved.size(), (int)symbols.size());
+
+		vector<const Symbol*> resolved;
+		resolved.resize(unresolved.size());
+		symEngine->GetSymbols(unresolved.data(), unresolved.size(), resolved.data());
+
+		for (const Symbol* symbol : resolved)
+			if (symbol)
+				symbols.push_back(symbolCache.Add(*symbol));
 	}
 
 	stream << symbols;
+	symbolCache.Trim();
 	return true;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool CallstackCollector::SerializeCallstacks(OutputDataStream& stream)
 {
-	stream << callstacksPool;
+	stream << callstackTree << samplesPool;
 
-	if (!callstacksPool.IsEmpty())
+	if (!IsEmpty())
 	{
-		callstacksPool.Clear(false);
+		Clear();
 		return true;
 	}
 
@@ -704,7 +1073,8 @@ bool CallstackCollector::SerializeCallstacks(OutputDataStream& stream)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool CallstackCollector::IsEmpty() const
 {
-	return callstacksPool.IsEmpty();
+	// Allocation callstacks are stored in the tree without samples
+	return samplesPool.IsEmpty() && callstackTree.Size() == 0;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -737,6 +1107,101 @@ bool SwitchContextCollector::Serialize(OutputDataStream& stream)
 	return false;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream & operator<<(OutputDataStream &stream, const WakeupDesc &ob)
+{
+	return stream << ob.timestamp << ob.wakerThreadId << ob.wakeeThreadId << ob.cpuId;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void WakeupCollector::Add(const WakeupDesc& desc)
+{
+	wakeupPool.Add() = desc;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void WakeupCollector::Clear()
+{
+	wakeupPool.Clear(false);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool WakeupCollector::Serialize(OutputDataStream& stream)
+{
+	stream << wakeupPool;
+
+	if (!wakeupPool.IsEmpty())
+	{
+		wakeupPool.Clear(false);
+		return true;
+	}
+
+	return false;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SystemCounterSampler::SystemCounterSampler() : isActive(false), counters(nullptr), storage(nullptr), sampleDescription(nullptr)
+{
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SystemCounterSampler::~SystemCounterSampler()
+{
+	Stop();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SystemCounterSampler::Start()
+{
+	if (isActive)
+		return true;
+
+#if OPTICK_ENABLE_TRACING
+	counters = Platform::CreateSystemCounters();
+#endif
+
+	if (counters == nullptr)
+		return false;
+
+	if (storage == nullptr)
+	{
+		storage = RegisterStorage("System Counters");
+		sampleDescription = EventDescription::Create("Sample", __FILE__, __LINE__);
+	}
+
+	isActive = true;
+	workerThread = std::thread(&SystemCounterSampler::Worker, this);
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SystemCounterSampler::Stop()
+{
+	if (workerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(workerLock);
+			isActive = false;
+		}
+		workerWakeup.notify_all();
+		workerThread.join();
+	}
+
+	isActive = false;
+
+	Memory::Delete(counters);
+	counters = nullptr;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SystemCounterSampler::Worker()
+{
+	Memory::InitThread();
+
+	std::unique_lock<std::mutex> lock(workerLock);
+
+	// Every sample is an event covering the interval, counters are attached to its start (deltas are accumulated over the interval)
+	int64 start = GetHighPrecisionTime();
+	while (!workerWakeup.wait_for(lock, std::chrono::milliseconds(SYSTEM_COUNTERS_SAMPLING_INTERVAL_MS), [this]() { return !isActive; }))
+	{
+		int64 finish = GetHighPrecisionTime();
+		Event::Add(storage, sampleDescription, start, finish);
+		counters->Sample(*storage, start);
+		start = finish;
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -918,37 +1383,182 @@ void Core::DumpEvents(EventStorage& entry, const EventTime& timeSlice, ScopeData
 			}
 		});
 
-		scope.Send();
-
-		entry.eventBuffer.Clear(false);
+		scope.Send();
+
+		entry.eventBuffer.Clear(false);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::DumpTags(EventStorage& entry, ScopeData& scope)
+{
+	if (!entry.tagFloatBuffer.IsEmpty() ||
+		!entry.tagS32Buffer.IsEmpty() ||
+		!entry.tagU32Buffer.IsEmpty() ||
+		!entry.tagU64Buffer.IsEmpty() ||
+		!entry.tagPointBuffer.IsEmpty() ||
+		!entry.tagStringBuffer.IsEmpty())
+	{
+		OutputDataStream tagStream;
+		tagStream << scope.header.boardNumber << scope.header.threadNumber;
+		tagStream  
+			<< (uint32)0
+			<< entry.tagFloatBuffer
+			<< entry.tagU32Buffer
+			<< entry.tagS32Buffer
+			<< entry.tagU64Buffer
+			<< entry.tagPointBuffer
+			<< (uint32)0
+			<< (uint32)0
+			<< entry.tagStringArena
+			<< entry.tagStringBuffer;
+		Server::Get().Send(DataResponse::TagsPack, tagStream);
+
+		entry.ClearTags(false);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::DumpCounters(EventStorage& entry, ScopeData& scope)
+{
+	if (!entry.counterBuffer.IsEmpty())
+	{
+		OutputDataStream counterStream;
+		counterStream << scope.header.boardNumber << scope.header.threadNumber;
+		counterStream << entry.counterBuffer;
+		Server::Get().Send(DataResponse::CounterPack, counterStream);
+
+		entry.counterBuffer.Clear(false);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::DumpMarks(EventStorage& entry, ScopeData& scope)
+{
+	if (!entry.markBuffer.IsEmpty())
+	{
+		OutputDataStream markStream;
+		markStream << scope.header.boardNumber << scope.header.threadNumber;
+		markStream << entry.markBuffer;
+		Server::Get().Send(DataResponse::MarkPack, markStream);
+
+		entry.markBuffer.Clear(false);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::DumpAllocations(EventStorage& entry, ScopeData& scope)
+{
+	if (!entry.allocationBuffer.IsEmpty())
+	{
+		vector<uint64> frames;
+		frames.resize(entry.allocationFrames.Size());
+		if (!frames.empty())
+			entry.allocationFrames.ToArray(&frames[0]);
+
+		OutputDataStream allocationStream;
+		allocationStream << scope.header.boardNumber << scope.header.threadNumber;
+		allocationStream << (uint32)entry.allocationBuffer.Size();
+
+		// Sampled callstacks are merged into the common callstack tree (sent later with the CallstackPack)
+		size_t frameIndex = 0;
+		entry.allocationBuffer.ForEach([&](const AllocationData& data)
+		{
+			uint32 stackID = 0;
+			if (data.stackDepth > 0 && frameIndex + data.stackDepth <= frames.size())
+			{
+				stackID = callstackCollector.AddCallstack(&frames[frameIndex], data.stackDepth);
+				frameIndex += data.stackDepth;
+			}
+			allocationStream << data.timestamp << data.address << data.size << (uint8)data.type << stackID;
+		});
+
+		Server::Get().Send(DataResponse::AllocationPack, allocationStream);
+
+		entry.allocationBuffer.Clear(false);
+		entry.allocationFrames.Clear(false);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::DumpLocks(EventStorage& entry, ScopeData& scope)
+{
+	if (!entry.lockBuffer.IsEmpty())
+	{
+		OutputDataStream lockStream;
+		lockStream << scope.header.boardNumber << scope.header.threadNumber;
+		lockStream << (uint32)entry.lockBuffer.Size();
+		entry.lockBuffer.ForEach([&](const LockData& data)
+		{
+			lockStream << data.start << data.finish << data.description->index << data.address << (uint8)data.type;
+		});
+		Server::Get().Send(DataResponse::LockPack, lockStream);
+
+		entry.lockBuffer.Clear(false);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::DumpFlows(EventStorage& entry, ScopeData& scope)
+{
+	if (!entry.flowBuffer.IsEmpty())
+	{
+		OutputDataStream flowStream;
+		flowStream << scope.header.boardNumber << scope.header.threadNumber;
+		flowStream << (uint32)entry.flowBuffer.Size();
+		entry.flowBuffer.ForEach([&](const FlowData& data)
+		{
+			flowStream << data.timestamp << data.id << data.description->index << (uint8)data.type;
+		});
+		Server::Get().Send(DataResponse::FlowPack, flowStream);
+
+		entry.flowBuffer.Clear(false);
 	}
 }
-
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Core::DumpTags(EventStorage& entry, ScopeData& scope)
+void Core::DumpAsyncEvents(EventStorage& entry, const EventTime& timeSlice, ScopeData& scope)
 {
-	if (!entry.tagFloatBuffer.IsEmpty() ||
-		!entry.tagS32Buffer.IsEmpty() ||
-		!entry.tagU32Buffer.IsEmpty() ||
-		!entry.tagU64Buffer.IsEmpty() ||
-		!entry.tagPointBuffer.IsEmpty() ||
-		!entry.tagStringBuffer.IsEmpty())
+	if (!entry.asyncEventBuffer.IsEmpty())
 	{
-		OutputDataStream tagStream;
-		tagStream << scope.header.boardNumber << scope.header.threadNumber;
-		tagStream  
-			<< (uint32)0
-			<< entry.tagFloatBuffer
-			<< entry.tagU32Buffer
-			<< entry.tagS32Buffer
-			<< entry.tagU64Buffer
-			<< entry.tagPointBuffer
-			<< (uint32)0
-			<< (uint32)0
-			<< entry.tagStringBuffer;
-		Server::Get().Send(DataResponse::TagsPack, tagStream);
+		vector<const AsyncEventData*> spans;
+		entry.asyncEventBuffer.ForEach([&](const AsyncEventData& data)
+		{
+			if (data.finish >= data.start && data.start >= timeSlice.start && timeSlice.finish >= data.finish)
+				spans.push_back(&data);
+		});
 
-		entry.ClearTags(false);
+		std::sort(spans.begin(), spans.end(), [](const AsyncEventData* a, const AsyncEventData* b) { return a->start < b->start; });
+
+		// Greedy interval partitioning: the lane which is released first is reused (min-heap by the finish of the last span)
+		typedef std::pair<int64, uint32> Lane;
+		vector<Lane> lanes;
+		vector<uint32> spanLanes;
+		spanLanes.reserve(spans.size());
+		uint32 laneCount = 0;
+
+		for (const AsyncEventData* data : spans)
+		{
+			uint32 lane = 0;
+			if (!lanes.empty() && lanes.front().first <= data->start)
+			{
+				std::pop_heap(lanes.begin(), lanes.end(), std::greater<Lane>());
+				lane = lanes.back().second;
+				lanes.pop_back();
+			}
+			else
+			{
+				lane = laneCount++;
+			}
+
+			spanLanes.push_back(lane);
+			lanes.push_back(Lane(data->finish, lane));
+			std::push_heap(lanes.begin(), lanes.end(), std::greater<Lane>());
+		}
+
+		OutputDataStream asyncStream;
+		asyncStream << scope.header.boardNumber << scope.header.threadNumber;
+		asyncStream << laneCount << (uint32)spans.size();
+		for (size_t i = 0; i < spans.size(); ++i)
+			asyncStream << spans[i]->start << spans[i]->finish << spans[i]->description->index << spans[i]->id << spanLanes[i];
+		Server::Get().Send(DataResponse::AsyncPack, asyncStream);
+
+		entry.asyncEventBuffer.Clear(false);
+		entry.asyncEventsInFlight.clear();
 	}
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -962,6 +1572,12 @@ void Core::DumpThread(ThreadEntry& entry, const EventTime& timeSlice, ScopeData&
 	DumpProgressFormatted("Serializing %s", entry.description.name.c_str());
 	DumpEvents(entry.storage, timeSlice, scope);
 	DumpTags(entry.storage, scope);
+	DumpCounters(entry.storage, scope);
+	DumpMarks(entry.storage, scope);
+	DumpAllocations(entry.storage, scope);
+	DumpLocks(entry.storage, scope);
+	DumpFlows(entry.storage, scope);
+	DumpAsyncEvents(entry.storage, timeSlice, scope);
 	OPTICK_ASSERT(entry.storage.fiberSyncBuffer.IsEmpty(), "Fiber switch events in native threads?");
 }
 
@@ -1011,7 +1627,11 @@ void Core::DumpFrames(uint32 mode)
     std::lock_guard<std::recursive_mutex> lock(threadsLock);
     
 	if (frames.empty() || threads.empty())
+	{
+		// The next network dump shouldn't be redirected to the collector
+		Server::Get().CancelSaveCollector();
 		return;
+	}
 
 	++boardNumber;
 
@@ -1020,6 +1640,25 @@ void Core::DumpFrames(uint32 mode)
 	DumpProgress("Generating summary...");
 
 	GenerateCommonSummary();
+
+	if (mode & Mode::HW_COUNTERS)
+		GenerateHWCountersSummary();
+
+	if (mode & Mode::CPU_TIME)
+		GenerateCPUTimeSummary();
+
+	if (mode & Mode::TAGS)
+		GenerateCountersSummary();
+
+	if (mode & Mode::ALLOCATIONS)
+		GenerateAllocationsSummary();
+
+	if (mode & Mode::LOCKS)
+		GenerateLocksSummary();
+
+	if (mode & Mode::INSTRUMENTATION)
+		GenerateFlowsSummary();
+
 	DumpSummary();
 
 	DumpProgress("Collecting Frame Events...");
@@ -1085,6 +1724,14 @@ void Core::DumpFrames(uint32 mode)
 		Server::Get().Send(DataResponse::SynchronizationData, switchContextsStream);
 	}
 
+	{
+		DumpProgress("Serializing Wakeups");
+		OutputDataStream wakeupsStream;
+		wakeupsStream << boardNumber;
+		wakeupCollector.Serialize(wakeupsStream);
+		Server::Get().Send(DataResponse::WakeupPack, wakeupsStream);
+	}
+
 	{
 		DumpProgress("Serializing SysCalls");
 		OutputDataStream callstacksStream;
@@ -1206,6 +1853,313 @@ void Core::GenerateCommonSummary()
 		AttachSummary("GPU", gpuProfiler->GetName().c_str());
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::GenerateHWCountersSummary()
+{
+	HWCounterValues total;
+	memset(&total, 0, sizeof(total));
+
+	for (const ThreadEntry* entry : threads)
+	{
+		HWCounterValues values;
+		if (entry->hwCounters && entry->hwCounters->ReadTotal(values))
+			for (int i = 0; i < HWCounterValues::COUNT; ++i)
+				total.values[i] += values.values[i];
+	}
+
+	uint64 cycles = total.values[HWCounterValues::CYCLES];
+	uint64 instructions = total.values[HWCounterValues::INSTRUCTIONS];
+
+	if (cycles == 0 || instructions == 0)
+		return;
+
+	char buffer[64] = { 0 };
+
+	sprintf_s(buffer, "%.2f", (double)instructions / cycles);
+	AttachSummary("IPC", buffer);
+
+	sprintf_s(buffer, "%.2f", 1000.0 * total.values[HWCounterValues::CACHE_MISSES] / instructions);
+	AttachSummary("Cache Misses (per 1K instructions)", buffer);
+
+	sprintf_s(buffer, "%.2f", 1000.0 * total.values[HWCounterValues::BRANCH_MISSES] / instructions);
+	AttachSummary("Branch Misses (per 1K instructions)", buffer);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::GenerateCPUTimeSummary()
+{
+	int64 cpuTime = 0;
+	int64 wallTime = 0;
+
+	for (const ThreadEntry* entry : threads)
+	{
+		cpuTime += entry->storage.cpuTimeTotal;
+		wallTime += entry->storage.cpuTimeWallTotal;
+	}
+
+	if (wallTime == 0)
+		return;
+
+	char buffer[64] = { 0 };
+
+	sprintf_s(buffer, "%.3f", cpuTime / 1000000.0);
+	AttachSummary("CPU Time (ms)", buffer);
+
+	sprintf_s(buffer, "%.1f%%", 100.0 * cpuTime / wallTime);
+	AttachSummary("CPU Time / Wall Time", buffer);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::GenerateCountersSummary()
+{
+	struct CounterStats
+	{
+		const char* name;
+		double minValue;
+		double maxValue;
+		double sum;
+		uint64 count;
+	};
+
+	// Samples with the same name are merged into a single track (even if they come from different threads)
+	vector<CounterStats> stats;
+	unordered_map<const EventDescription*, size_t> statIndices;
+
+	for (ThreadEntry* entry : threads)
+	{
+		entry->storage.counterBuffer.ForEach([&](const CounterSample& sample)
+		{
+			auto it = statIndices.find(sample.description);
+			if (it == statIndices.end())
+			{
+				CounterStats counter = { sample.description->name, sample.data, sample.data, 0.0, 0 };
+				it = statIndices.insert({ sample.description, stats.size() }).first;
+				stats.push_back(counter);
+			}
+
+			CounterStats& counter = stats[it->second];
+			counter.minValue = std::min(counter.minValue, sample.data);
+			counter.maxValue = std::max(counter.maxValue, sample.data);
+			counter.sum += sample.data;
+			++counter.count;
+		});
+	}
+
+	for (const CounterStats& counter : stats)
+	{
+		char buffer[128] = { 0 };
+		sprintf_s(buffer, "min: %.3f max: %.3f avg: %.3f", counter.minValue, counter.maxValue, counter.sum / counter.count);
+		AttachSummary(counter.name, buffer);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::GenerateAllocationsSummary()
+{
+	vector<AllocationData> allocations;
+	for (ThreadEntry* entry : threads)
+	{
+		size_t offset = allocations.size();
+		allocations.resize(offset + entry->storage.allocationBuffer.Size());
+		if (offset < allocations.size())
+			entry->storage.allocationBuffer.ToArray(&allocations[offset]);
+	}
+
+	if (allocations.empty())
+		return;
+
+	// Memory could be freed by another thread
+	std::sort(allocations.begin(), allocations.end(), [](const AllocationData& a, const AllocationData& b) { return a.timestamp < b.timestamp; });
+
+	uint64 allocationCount = 0;
+	uint64 allocatedBytes = 0;
+	uint64 liveBytes = 0;
+	unordered_map<uint64, uint64> liveAllocations;
+
+	for (const AllocationData& data : allocations)
+	{
+		if (data.type == AllocationData::ALLOC)
+		{
+			++allocationCount;
+			allocatedBytes += data.size;
+			liveBytes += data.size;
+			liveAllocations[data.address] = data.size;
+		}
+		else
+		{
+			// Blocks allocated before the capture are not tracked
+			auto it = liveAllocations.find(data.address);
+			if (it != liveAllocations.end())
+			{
+				liveBytes -= it->second;
+				liveAllocations.erase(it);
+			}
+		}
+	}
+
+	// Allocations per frame
+	uint32 frameCount = 0;
+	uint64 maxFrameAllocations = 0;
+	for (const EventTime& frame : frames[FrameType::CPU].m_Frames)
+	{
+		auto begin = std::lower_bound(allocations.begin(), allocations.end(), frame.start, [](const AllocationData& data, int64 timestamp) { return data.timestamp < timestamp; });
+		auto end = std::lower_bound(begin, allocations.end(), frame.finish, [](const AllocationData& data, int64 timestamp) { return data.timestamp < timestamp; });
+
+		uint64 frameAllocations = (uint64)std::count_if(begin, end, [](const AllocationData& data) { return data.type == AllocationData::ALLOC; });
+		maxFrameAllocations = std::max(maxFrameAllocations, frameAllocations);
+		++frameCount;
+	}
+
+	char buffer[64] = { 0 };
+
+	sprintf_s(buffer, "%llu", (unsigned long long)allocationCount);
+	AttachSummary("Allocations", buffer);
+
+	sprintf_s(buffer, "%.3f", allocatedBytes / (1024.0 * 1024.0));
+	AttachSummary("Allocated (MB)", buffer);
+
+	sprintf_s(buffer, "%.3f", liveBytes / (1024.0 * 1024.0));
+	AttachSummary("Not Freed by the End of Capture (MB)", buffer);
+
+	if (frameCount > 0)
+	{
+		sprintf_s(buffer, "%.1f / %llu", (double)allocationCount / frameCount, (unsigned long long)maxFrameAllocations);
+		AttachSummary("Allocations per Frame (avg / max)", buffer);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::GenerateLocksSummary()
+{
+	struct LockStats
+	{
+		const char* name;
+		uint64 acquireCount;
+		uint64 waitCount;
+		int64 waitTime;
+		int64 maxWaitTime;
+		int64 holdTime;
+	};
+
+	// Locks with the same name share the description and are reported together
+	vector<LockStats> stats;
+	unordered_map<const EventDescription*, size_t> statIndices;
+
+	for (ThreadEntry* entry : threads)
+	{
+		entry->storage.lockBuffer.ForEach([&](const LockData& data)
+		{
+			auto it = statIndices.find(data.description);
+			if (it == statIndices.end())
+			{
+				LockStats lock = { data.description->name, 0, 0, 0, 0, 0 };
+				it = statIndices.insert({ data.description, stats.size() }).first;
+				stats.push_back(lock);
+			}
+
+			LockStats& lock = stats[it->second];
+			int64 duration = data.finish - data.start;
+			if (data.type == LockData::WAIT)
+			{
+				++lock.waitCount;
+				lock.waitTime += duration;
+				lock.maxWaitTime = std::max(lock.maxWaitTime, duration);
+			}
+			else
+			{
+				++lock.acquireCount;
+				lock.holdTime += duration;
+			}
+		});
+	}
+
+	// The most contended locks go first
+	std::sort(stats.begin(), stats.end(), [](const LockStats& a, const LockStats& b) { return a.waitTime > b.waitTime; });
+
+	double ticksToMs = 1000.0 / Platform::GetFrequency();
+
+	for (const LockStats& lock : stats)
+	{
+		char name[128] = { 0 };
+		sprintf_s(name, "Lock: %s", lock.name);
+
+		char buffer[128] = { 0 };
+		sprintf_s(buffer, "contended: %llu / %llu wait: %.3f ms (max: %.3f ms) hold: %.3f ms",
+			(unsigned long long)lock.waitCount, (unsigned long long)lock.acquireCount,
+			lock.waitTime * ticksToMs, lock.maxWaitTime * ticksToMs, lock.holdTime * ticksToMs);
+		AttachSummary(name, buffer);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::GenerateFlowsSummary()
+{
+	vector<FlowData> flows;
+	for (ThreadEntry* entry : threads)
+	{
+		size_t offset = flows.size();
+		flows.resize(offset + entry->storage.flowBuffer.Size());
+		if (offset < flows.size())
+			entry->storage.flowBuffer.ToArray(&flows[offset]);
+	}
+
+	if (flows.empty())
+		return;
+
+	// Begin and end markers come from different threads
+	std::sort(flows.begin(), flows.end(), [](const FlowData& a, const FlowData& b) { return a.timestamp < b.timestamp; });
+
+	struct FlowStats
+	{
+		const char* name;
+		uint64 count;
+		int64 latency;
+		int64 maxLatency;
+	};
+
+	// Job type is defined by the description of the BEGIN marker
+	vector<FlowStats> stats;
+	unordered_map<const EventDescription*, size_t> statIndices;
+	unordered_map<uint64, const FlowData*> pending;
+
+	for (const FlowData& data : flows)
+	{
+		if (data.type == FlowData::BEGIN)
+		{
+			pending[data.id] = &data;
+			continue;
+		}
+
+		// Jobs enqueued before the capture are skipped
+		auto begin = pending.find(data.id);
+		if (begin == pending.end())
+			continue;
+
+		const EventDescription* description = begin->second->description;
+		int64 latency = data.timestamp - begin->second->timestamp;
+		pending.erase(begin);
+
+		auto it = statIndices.find(description);
+		if (it == statIndices.end())
+		{
+			FlowStats flow = { description->name, 0, 0, 0 };
+			it = statIndices.insert({ description, stats.size() }).first;
+			stats.push_back(flow);
+		}
+
+		FlowStats& flow = stats[it->second];
+		++flow.count;
+		flow.latency += latency;
+		flow.maxLatency = std::max(flow.maxLatency, latency);
+	}
+
+	double ticksToMs = 1000.0 / Platform::GetFrequency();
+
+	for (const FlowStats& flow : stats)
+	{
+		char name[128] = { 0 };
+		sprintf_s(name, "Queue Latency: %s", flow.name);
+
+		char buffer[128] = { 0 };
+		sprintf_s(buffer, "jobs: %llu avg: %.3f ms max: %.3f ms", (unsigned long long)flow.count, flow.latency * ticksToMs / flow.count, flow.maxLatency * ticksToMs);
+		AttachSummary(name, buffer);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 Core::Core()
 	: progressReportedLastTimestampMS(0)
 	, boardNumber(0)
@@ -1219,9 +2173,16 @@ Core::Core()
 	, tracer(nullptr)
 	, gpuProfiler(nullptr)
 {
-	frames[FrameType::CPU].m_Description = EventDescription::Create("CPU Frame", __FILE__, __LINE__);
+	frames[FrameType::CPU].m_Description = EventDescription::Create("CPU Frame", __FILE__, __LINE__, Color::Null, 0, EventDescription::COUNT_HW_COUNTERS | EventDescription::COUNT_CPU_TIME);
 	frames[FrameType::GPU].m_Description = EventDescription::Create("GPU Frame", __FILE__, __LINE__);
-	frames[FrameType::Render].m_Description = EventDescription::Create("Render Frame", __FILE__, __LINE__);
+	frames[FrameType::Render].m_Description = EventDescription::Create("Render Frame", __FILE__, __LINE__, Color::Null, 0, EventDescription::COUNT_HW_COUNTERS | EventDescription::COUNT_CPU_TIME);
+
+	hwCounterDescriptions[HWCounterValues::CYCLES] = EventDescription::Create("Cycles", __FILE__, __LINE__);
+	hwCounterDescriptions[HWCounterValues::INSTRUCTIONS] = EventDescription::Create("Instructions", __FILE__, __LINE__);
+	hwCounterDescriptions[HWCounterValues::CACHE_MISSES] = EventDescription::Create("Cache Misses", __FILE__, __LINE__);
+	hwCounterDescriptions[HWCounterValues::BRANCH_MISSES] = EventDescription::Create("Branch Misses", __FILE__, __LINE__);
+
+	cpuTimeDescription = EventDescription::Create("CPU Time (ms)", __FILE__, __LINE__);
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool Core::UpdateState()
@@ -1334,6 +2295,12 @@ bool Core::ReportSwitchContext(const SwitchContextDesc& desc)
 	switchContextCollector.Add(desc);
 	return true;
 }
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Core::ReportWakeup(const WakeupDesc& desc)
+{
+	wakeupCollector.Add(desc);
+	return true;
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool Core::ReportStackWalk(const CallstackDesc& desc)
@@ -1383,7 +2350,7 @@ void Core::Activate(Mode::Type mode)
 				}
 			}
 
-			if (mode & Mode::AUTOSAMPLING)
+			if (mode & (Mode::AUTOSAMPLING | Mode::ALLOCATION_CALLSTACKS))
 				if (symbolEngine == nullptr)
 					symbolEngine = Platform::CreateSymbolEngine();
 #endif
@@ -1391,12 +2358,17 @@ void Core::Activate(Mode::Type mode)
 			if (gpuProfiler && (mode & Mode::GPU))
 				gpuProfiler->Start(mode);
 
+			if (mode & Mode::SYSTEM_COUNTERS)
+				systemCounterSampler.Start();
+
 			SendHandshakeResponse(status);
 		}
 		else
 		{
 			if (tracer)
 			{
+				// RegisterThread might access the tracer as well
+				std::lock_guard<std::recursive_mutex> lock(threadsLock);
 				tracer->Stop();
 				Memory::Delete(tracer);
 				tracer = nullptr;
@@ -1405,6 +2377,8 @@ void Core::Activate(Mode::Type mode)
 
 			if (gpuProfiler)
 				gpuProfiler->Stop(previousMode);
+
+			systemCounterSampler.Stop();
 		}
 	}
 }
@@ -1435,6 +2409,7 @@ void Core::SendHandshakeResponse(CaptureStatus::Type status)
 	stream << (uint32)status;
 	stream << Platform::GetName();
 	stream << Server::Get().GetHostName();
+	stream << Server::Get().GetStreamFlags();
 	Server::Get().Send(DataResponse::Handshake, stream);
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1464,6 +2439,25 @@ ThreadEntry* Core::RegisterThread(const ThreadDescription& description, EventSto
 	{
 		entry = Memory::New<ThreadEntry>(description, slot);
 		threads.push_back(entry);
+
+		if (description.threadID == Platform::GetThreadID())
+			Platform::GetThreadStack(entry->stackBegin, entry->stackEnd);
+
+#if OPTICK_ENABLE_TRACING
+		if (currentMode & Mode::HW_COUNTERS)
+		{
+			if ((entry->hwCounters = Platform::CreateHWCounters(description.threadID)) != nullptr)
+			{
+				entry->hwCounters->Start();
+				entry->storage.hwCounters = entry->hwCounters;
+			}
+		}
+#endif
+
+#if OPTICK_ENABLE_TRACING
+		if (tracer && (currentMode != Mode::OFF))
+			tracer->AddThread(entry);
+#endif
 	}
 	else
 	{
@@ -1471,7 +2465,11 @@ ThreadEntry* Core::RegisterThread(const ThreadDescription& description, EventSto
 	}
 
 	if ((currentMode != Mode::OFF) && slot != nullptr)
+	{
+		// Mode-dependent collection (tags, CPU time) for the threads registered in the middle of the capture
+		entry->storage.currentMode = currentMode;
 		*slot = &entry->storage;
+	}
 
 	return entry;
 }
@@ -1633,6 +2631,9 @@ const EventDescription* Core::GetFrameDescription(FrameType::Type frame) const
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Core::Shutdown()
 {
+	// Sampler writes into one of the thread storages
+	systemCounterSampler.Stop();
+
 	std::lock_guard<std::recursive_mutex> lock(threadsLock);
 
 	Memory::Delete<GPUProfiler>(gpuProfiler);
@@ -1928,6 +2929,9 @@ OPTICK_API bool SaveCapture(const char* path, bool force /*= true*/)
 #endif
 	}
 
+	if (Server::Get().SetSaveCollector(filePath))
+		return SaveCapture((CaptureSaveChunkCb)nullptr, force);
+
 	SaveHelper::Init(filePath);
 	return SaveCapture(SaveHelper::Write, force);
 }
@@ -1944,14 +2948,112 @@ OPTICK_API bool SaveCapture(CaptureSaveChunkCb dataCb /*= nullptr*/, bool force
 	return true;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OPTICK_API bool AttachCollector(const char* name /*= nullptr*/)
+{
+	return Server::Get().AttachCollector(name);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OPTICK_API void DetachCollector()
+{
+	Server::Get().DetachCollector();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 OPTICK_API void Shutdown()
 {
 	Core::Get().Shutdown();
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-EventStorage::EventStorage(): currentMode(Mode::OFF), pushPopEventStackIndex(0), isFiberStorage(false)
+EventStorage::EventStorage(): currentMode(Mode::OFF), allocationBytesToSample(ALLOCATION_CALLSTACK_SAMPLING_BYTES), isInsideAllocation(false), pushPopEventStackIndex(0), hwCounters(nullptr), hwCounterStackIndex(0), cpuTimeStackIndex(0), cpuTimeTotal(0), cpuTimeWallTotal(0), isFiberStorage(false)
 {
 	 
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EventStorage::PushHWCounters()
+{
+	if (hwCounters != nullptr)
+		if (hwCounterStackIndex++ < hwCounterStack.size())
+			hwCounters->Read(hwCounterStack[hwCounterStackIndex - 1]);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EventStorage::PopHWCounters(const EventData& data)
+{
+	if (hwCounters != nullptr && hwCounterStackIndex > 0)
+	{
+		if (--hwCounterStackIndex < hwCounterStack.size())
+		{
+			HWCounterValues values;
+			hwCounters->Read(values);
+
+			// Start timestamp binds the tag to the scope itself (children start later)
+			const HWCounterValues& start = hwCounterStack[hwCounterStackIndex];
+			for (int i = 0; i < HWCounterValues::COUNT; ++i)
+				tagU64Buffer.Add(TagU64(*Core::Get().hwCounterDescriptions[i], values.values[i] - start.values[i], data.start));
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EventStorage::AddAllocation(const void* address, uint64 size, AllocationData::Type type)
+{
+	if (isInsideAllocation)
+		return;
+
+	isInsideAllocation = true;
+
+	AllocationData& data = allocationBuffer.Add();
+	data.timestamp = GetHighPrecisionTime();
+	data.address = (uint64)address;
+	data.size = size;
+	data.type = type;
+	data.stackDepth = 0;
+
+	if (type == AllocationData::ALLOC && (currentMode & Mode::ALLOCATION_CALLSTACKS))
+	{
+		allocationBytesToSample -= (int64)size;
+		if (allocationBytesToSample <= 0)
+		{
+			allocationBytesToSample = ALLOCATION_CALLSTACK_SAMPLING_BYTES;
+
+			uint64 callstack[ALLOCATION_CALLSTACK_MAX_DEPTH];
+			uint32 depth = Platform::GetCallstack(callstack, ALLOCATION_CALLSTACK_MAX_DEPTH);
+			for (uint32 i = 0; i < depth; ++i)
+				allocationFrames.Add(callstack[i]);
+
+			data.stackDepth = (uint8)depth;
+		}
+	}
+
+	isInsideAllocation = false;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EventStorage::PushCPUTime()
+{
+	if (currentMode & Mode::CPU_TIME)
+		if (cpuTimeStackIndex++ < cpuTimeStack.size())
+			cpuTimeStack[cpuTimeStackIndex - 1] = Platform::GetThreadCPUTime();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EventStorage::PopCPUTime(const EventData& data)
+{
+	if ((currentMode & Mode::CPU_TIME) && cpuTimeStackIndex > 0)
+	{
+		if (--cpuTimeStackIndex < cpuTimeStack.size())
+		{
+			int64 cpuTime = Platform::GetThreadCPUTime() - cpuTimeStack[cpuTimeStackIndex];
+			tagFloatBuffer.Add(TagFloat(*Core::Get().cpuTimeDescription, (float)(cpuTime / 1000000.0), data.start));
+
+			// Nested scopes are already accounted by the parent
+			if (cpuTimeStackIndex == 0)
+			{
+				cpuTimeTotal += cpuTime;
+				cpuTimeWallTotal += (int64)((data.finish - data.start) * 1000000000.0 / Platform::GetFrequency());
+			}
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ThreadEntry::~ThreadEntry()
+{
+	Memory::Delete(hwCounters);
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void ThreadEntry::Activate(Mode::Type mode)
@@ -1962,6 +3064,21 @@ void ThreadEntry::Activate(Mode::Type mode)
 	if (mode != Mode::OFF)
 		storage.Clear(true);
 
+#if OPTICK_ENABLE_TRACING
+	if ((mode & Mode::HW_COUNTERS) && hwCounters == nullptr)
+		hwCounters = Platform::CreateHWCounters(description.threadID);
+#endif
+
+	if (hwCounters != nullptr)
+	{
+		if (mode & Mode::HW_COUNTERS)
+			hwCounters->Start();
+		else
+			hwCounters->Stop();
+	}
+
+	storage.hwCounters = (mode & Mode::HW_COUNTERS) ? hwCounters : nullptr;
+
 	if (threadTLS != nullptr)
 	{
 		storage.currentMode = mode;
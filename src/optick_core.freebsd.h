@@ -27,6 +27,7 @@
 #if USE_OPTICK
 
 #include "optick_core.platform.h"
+#include "optick_core.posix.h"
 
 #include <sys/time.h>
 #include <sys/types.h>
@@ -62,6 +63,18 @@ namespace Optick
 		return ts.tv_sec * 1000000000LL + ts.tv_nsec;
 	}
 
+	int64 Platform::GetThreadCPUTime()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	}
+
+	bool Platform::GetThreadStack(uint64&, uint64&)
+	{
+		return false;
+	}
+
 	Trace* Platform::CreateTrace()
 	{
 		return nullptr;
@@ -71,6 +84,16 @@ namespace Optick
 	{
 		return nullptr;
 	}
+
+	HWCounters* Platform::CreateHWCounters(ThreadID)
+	{
+		return nullptr;
+	}
+
+	SystemCounters* Platform::CreateSystemCounters()
+	{
+		return nullptr;
+	}
 }
 
 #endif //USE_OPTICK
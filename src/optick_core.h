@@ -25,6 +25,7 @@
 
 #if USE_OPTICK
 
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
@@ -76,7 +77,11 @@ namespace Optick
 {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct Trace;
+struct Module;
+struct Symbol;
 struct SymbolEngine;
+struct HWCounters;
+struct SystemCounters;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct ScopeHeader
 {
@@ -168,14 +173,61 @@ typedef MemoryPool<const EventData*, 32> CategoryBuffer;
 typedef MemoryPool<SyncData, 1024> SynchronizationBuffer;
 typedef MemoryPool<FiberSyncData, 1024> FiberSyncBuffer;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-typedef OptickString<32> ShortString;
+struct AsyncEventData : public EventData
+{
+	uint64 id;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef MemoryPool<AsyncEventData, 1024> AsyncEventBuffer;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Position of the string in the TagStringArena
+struct StringRef
+{
+	uint32 offset;
+	uint32 length;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Variable-length strings of the string tags (serialized as a single blob per storage).
+// A string never crosses the chunk boundary, so the interned values could be compared in place.
+class TagStringArena
+{
+	static const uint32 CHUNK_SIZE = 64 * 1024;
+
+	struct Entry
+	{
+		StringRef ref;
+		const char* data;
+	};
+
+	MemoryBuffer<CHUNK_SIZE> buffer;
+	// Offset of the next string (including the unused tails of the chunks)
+	uint32 size;
+	// Repeated values are stored once
+	unordered_map<StringHash, Entry> internTable;
+public:
+	// Longer strings are cut
+	static const uint32 MAX_LENGTH = 4096;
+	// Unique values (e.g. request IDs) are not interned after the table is full
+	static const uint32 MAX_INTERNED_COUNT = 4096;
+
+	TagStringArena() : size(0) {}
+
+	StringRef Add(const char* text, uint32 length);
+	void Clear(bool preserveMemory);
+
+	friend OutputDataStream& operator<<(OutputDataStream& stream, const TagStringArena& ob);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const StringRef& ob);
+OutputDataStream& operator<<(OutputDataStream& stream, const TagStringArena& ob);
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 typedef TagData<float> TagFloat;
 typedef TagData<int32> TagS32;
 typedef TagData<uint32> TagU32;
 typedef TagData<uint64> TagU64;
 typedef TagData<Point> TagPoint;
-typedef TagData<ShortString> TagString;
+typedef TagData<StringRef> TagString;
+typedef TagData<double> CounterSample;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 typedef MemoryPool<TagFloat, 1024> TagFloatBuffer;
 typedef MemoryPool<TagS32, 1024> TagS32Buffer;
@@ -183,6 +235,72 @@ typedef MemoryPool<TagU32, 1024> TagU32Buffer;
 typedef MemoryPool<TagU64, 1024> TagU64Buffer;
 typedef MemoryPool<TagPoint, 64> TagPointBuffer;
 typedef MemoryPool<TagString, 1024> TagStringBuffer;
+typedef MemoryPool<CounterSample, 1024> CounterBuffer;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Instant marker (OPTICK_MARK) - packed to 12 bytes (an empty EventData takes 24 bytes)
+#pragma pack(push, 4)
+struct MarkData
+{
+	int64 timestamp;
+	uint32 descriptionIndex;
+};
+#pragma pack(pop)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const MarkData& ob);
+typedef MemoryPool<MarkData, 1024> MarkBuffer;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct AllocationData
+{
+	enum Type : uint8
+	{
+		ALLOC,
+		FREE,
+	};
+
+	int64 timestamp;
+	uint64 address;
+	uint64 size;
+	Type type;
+	// Number of frames in EventStorage::allocationFrames (0 - callstack was not sampled)
+	uint8 stackDepth;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef MemoryPool<AllocationData, 1024> AllocationBuffer;
+typedef MemoryPool<uint64, 1024> AllocationFrameBuffer;
+// Callstack is captured once per this many allocated bytes (big allocations are always sampled)
+static const int64 ALLOCATION_CALLSTACK_SAMPLING_BYTES = 64 * 1024;
+static const uint32 ALLOCATION_CALLSTACK_MAX_DEPTH = 32;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct LockData : public EventTime
+{
+	enum Type : uint8
+	{
+		WAIT,
+		HOLD,
+	};
+
+	const EventDescription* description;
+	uint64 address;
+	Type type;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef MemoryPool<LockData, 1024> LockBuffer;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct FlowData
+{
+	enum Type : uint8
+	{
+		BEGIN,
+		END,
+	};
+
+	int64 timestamp;
+	uint64 id;
+	const EventDescription* description;
+	Type type;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef MemoryPool<FlowData, 1024> FlowBuffer;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -224,6 +342,20 @@ public:
 	friend OutputDataStream& operator << (OutputDataStream& stream, const EventDescriptionBoard& ob);
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct HWCounterValues
+{
+	enum Type
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		CACHE_MISSES,
+		BRANCH_MISSES,
+		COUNT,
+	};
+
+	uint64 values[COUNT];
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct EventStorage
 {
 	Mode::Type currentMode;
@@ -236,6 +368,27 @@ struct EventStorage
 	TagU64Buffer tagU64Buffer;
 	TagPointBuffer tagPointBuffer;
 	TagStringBuffer tagStringBuffer;
+	TagStringArena tagStringArena;
+
+	CounterBuffer counterBuffer;
+	MarkBuffer markBuffer;
+
+	// Allocation events (Mode::ALLOCATIONS), sampled callstacks are stored one after another
+	AllocationBuffer allocationBuffer;
+	AllocationFrameBuffer allocationFrames;
+	int64 allocationBytesToSample;
+	// Growth of the buffers is excluded by Memory::IsInternalCall, but unwinding could still hit the malloc hooks
+	bool isInsideAllocation;
+
+	// Contended acquires and ownership intervals of the instrumented locks (Mode::LOCKS)
+	LockBuffer lockBuffer;
+
+	// Flow markers (OPTICK_FLOW_BEGIN\OPTICK_FLOW_END)
+	FlowBuffer flowBuffer;
+
+	// Async spans (Event::BeginAsync\EndAsync), unfinished spans are indexed by ID
+	AsyncEventBuffer asyncEventBuffer;
+	unordered_map<uint64, AsyncEventData*> asyncEventsInFlight;
 
 	struct GPUStorage
 	{
@@ -253,6 +406,18 @@ struct EventStorage
 	uint32					    pushPopEventStackIndex;
 	array<EventData*, 32>		pushPopEventStack;
 
+	// Counters of the owner thread (Mode::HW_COUNTERS)
+	HWCounters*					hwCounters;
+	uint32						hwCounterStackIndex;
+	array<HWCounterValues, 32>	hwCounterStack;
+
+	// Thread CPU time at the start of the marked scopes (Mode::CPU_TIME)
+	uint32						cpuTimeStackIndex;
+	array<int64, 32>			cpuTimeStack;
+	// Accumulated for the outermost marked scopes (Nanoseconds)
+	int64						cpuTimeTotal;
+	int64						cpuTimeWallTotal;
+
 	bool isFiberStorage;
 
 	EventStorage();
@@ -262,6 +427,16 @@ struct EventStorage
 		return eventBuffer.Add(); 
 	}
 
+	// Snapshot of the counters at the start of the scope \ deltas are attached as tags at the end of the scope
+	void PushHWCounters();
+	void PopHWCounters(const EventData& data);
+
+	// Same for the thread CPU time
+	void PushCPUTime();
+	void PopCPUTime(const EventData& data);
+
+	void AddAllocation(const void* address, uint64 size, AllocationData::Type type);
+
 	// Free all temporary memory
 	void Clear(bool preserveContent)
 	{
@@ -270,12 +445,26 @@ struct EventStorage
 		fiberSyncBuffer.Clear(preserveContent);
 		gpuStorage.Clear(preserveContent);
 		ClearTags(preserveContent);
+		counterBuffer.Clear(preserveContent);
+		markBuffer.Clear(preserveContent);
+		allocationBuffer.Clear(preserveContent);
+		allocationFrames.Clear(preserveContent);
+		allocationBytesToSample = ALLOCATION_CALLSTACK_SAMPLING_BYTES;
+		lockBuffer.Clear(preserveContent);
+		flowBuffer.Clear(preserveContent);
+		asyncEventBuffer.Clear(preserveContent);
+		asyncEventsInFlight.clear();
 
 		while (pushPopEventStackIndex)
 		{
 			if (--pushPopEventStackIndex < pushPopEventStack.size())
 				pushPopEventStack[pushPopEventStackIndex] = nullptr;
 		}
+
+		hwCounterStackIndex = 0;
+		cpuTimeStackIndex = 0;
+		cpuTimeTotal = 0;
+		cpuTimeWallTotal = 0;
 	}
 
 	void ClearTags(bool preserveContent)
@@ -286,6 +475,7 @@ struct EventStorage
 		tagU64Buffer.Clear(preserveContent);
 		tagPointBuffer.Clear(preserveContent);
 		tagStringBuffer.Clear(preserveContent);
+		tagStringArena.Clear(preserveContent);
 	}
 
 	void Reset()
@@ -330,9 +520,17 @@ struct ThreadEntry
 	EventStorage storage;
 	EventStorage** threadTLS;
 
+	// Kept alive between the captures (the owner thread might still be in the middle of the scope)
+	HWCounters* hwCounters;
+
+	// Stack bounds recorded from the thread's own context (zero if unknown)
+	uint64 stackBegin;
+	uint64 stackEnd;
+
 	bool isAlive;
 
-	ThreadEntry(const ThreadDescription& desc, EventStorage** tls) : description(desc), threadTLS(tls), isAlive(true) {}
+	ThreadEntry(const ThreadDescription& desc, EventStorage** tls) : description(desc), threadTLS(tls), hwCounters(nullptr), stackBegin(0), stackEnd(0), isAlive(true) {}
+	~ThreadEntry();
 	void Activate(Mode::Type mode);
 	void Sort();
 };
@@ -382,13 +580,107 @@ struct CallstackDesc
 	uint8 count;
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Resolved symbols which survive between captures (key: module + offset inside the module)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class SymbolCache
+{
+	static const size_t MAX_MEMORY_SIZE = 16 << 20; // 16Mb
+
+	struct ModuleDesc
+	{
+		string path;
+		size_t size;
+	};
+
+	struct ModuleRange
+	{
+		uint64 begin;
+		uint64 end;
+		uint64 key;
+		bool operator<(const ModuleRange& other) const { return begin < other.begin; }
+	};
+
+	struct Entry
+	{
+		Symbol* symbol;
+		size_t memorySize;
+		uint32 generation;
+	};
+
+	// Module index is stored in the upper bits of the key
+	static const uint32 MODULE_KEY_SHIFT = 44;
+
+	vector<ModuleDesc> knownModules;
+	vector<ModuleRange> moduleRanges;
+	unordered_map<uint64, Entry> entries;
+	size_t memorySize;
+	uint32 generation;
+
+	bool GetKey(uint64 address, uint64& key) const;
+public:
+	SymbolCache() : memorySize(0), generation(0) {}
+	~SymbolCache();
+
+	// Updates the address ranges of the loaded modules (called once per capture)
+	void Begin(const vector<Module>& modules);
+	const Symbol* Find(uint64 address);
+	const Symbol* Add(const Symbol& symbol);
+	// Evicts symbols which were not used by the last capture if the cache exceeds the memory budget
+	void Trim();
+	void Clear();
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Prefix tree of the unique callstacks: each callstack is identified by the index of its leaf node
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CallstackTree
+{
+	struct Node
+	{
+		uint64 address;
+		uint32 parent;
+		uint32 next; // Next node in the same hash bucket (0 - end of the chain)
+	};
+
+	vector<Node> nodes;
+	vector<uint32> buckets;
+
+	static OPTICK_INLINE size_t GetHash(uint32 parent, uint64 address);
+	void Rehash(size_t bucketCount);
+public:
+	static const uint32 ROOT = 0;
+
+	// Returns the node of the 'address' frame called from the 'parent' node (adds a new node if needed)
+	uint32 Add(uint32 parent, uint64 address);
+	void Clear();
+
+	// Nodes are numbered [1..Size()], ROOT is not included
+	size_t Size() const { return nodes.empty() ? 0 : nodes.size() - 1; }
+	uint64 GetAddress(uint32 node) const { return nodes[node].address; }
+
+	friend OutputDataStream& operator<<(OutputDataStream& stream, const CallstackTree& ob);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CallstackSample
+{
+	uint64 threadID;
+	uint64 timestamp;
+	uint32 stackID;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+OutputDataStream& operator<<(OutputDataStream& stream, const CallstackSample& ob);
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class CallstackCollector
 {
-	// Packed callstack list: {ThreadID, Timestamp, Count, Callstack[Count]}
-	typedef MemoryPool<uint64, 1024 * 32> CallstacksPool;
-	CallstacksPool callstacksPool;
+	// Unique callstacks + sample list: {ThreadID, Timestamp, StackID}
+	typedef MemoryPool<CallstackSample, 1024 * 32> CallstackSamplePool;
+	CallstackSamplePool samplesPool;
+	CallstackTree callstackTree;
+
+	SymbolCache symbolCache;
 public:
 	void Add(const CallstackDesc& desc);
+	// Adds the callstack to the tree without a sample (returns stack ID)
+	uint32 AddCallstack(const uint64* callstack, uint32 count);
 	void Clear();
 
 	bool SerializeModules(OutputDataStream& stream);
@@ -421,6 +713,50 @@ public:
 	bool Serialize(OutputDataStream& stream);
 };
 //////////////////////////////////////////////////////////////////////////
+struct WakeupDesc
+{
+	int64_t timestamp;
+	uint64 wakerThreadId;
+	uint64 wakeeThreadId;
+	uint8 cpuId; // Target CPU of the wakee
+};
+//////////////////////////////////////////////////////////////////////////
+OutputDataStream &operator << (OutputDataStream &stream, const WakeupDesc &ob);
+//////////////////////////////////////////////////////////////////////////
+class WakeupCollector
+{
+	typedef MemoryPool<WakeupDesc, 1024 * 32> WakeupPool;
+	WakeupPool wakeupPool;
+public:
+	void Add(const WakeupDesc& desc);
+	void Clear();
+	bool Serialize(OutputDataStream& stream);
+};
+//////////////////////////////////////////////////////////////////////////
+// Background thread sampling process-level counters into a dedicated storage (Mode::SYSTEM_COUNTERS)
+//////////////////////////////////////////////////////////////////////////
+static const uint32 SYSTEM_COUNTERS_SAMPLING_INTERVAL_MS = 20;
+//////////////////////////////////////////////////////////////////////////
+class SystemCounterSampler
+{
+	std::thread workerThread;
+	std::mutex workerLock;
+	std::condition_variable workerWakeup;
+	bool isActive;
+
+	SystemCounters* counters;
+	EventStorage* storage;
+	const EventDescription* sampleDescription;
+
+	void Worker();
+public:
+	SystemCounterSampler();
+	~SystemCounterSampler();
+
+	bool Start();
+	void Stop();
+};
+//////////////////////////////////////////////////////////////////////////
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -476,6 +812,8 @@ class Core
 
 	CallstackCollector callstackCollector;
 	SwitchContextCollector switchContextCollector;
+	WakeupCollector wakeupCollector;
+	SystemCounterSampler systemCounterSampler;
 
 	vector<std::pair<string, string>> summary;
 
@@ -515,6 +853,12 @@ class Core
 
 	void DumpEvents(EventStorage& entry, const EventTime& timeSlice, ScopeData& scope);
 	void DumpTags(EventStorage& entry, ScopeData& scope);
+	void DumpCounters(EventStorage& entry, ScopeData& scope);
+	void DumpMarks(EventStorage& entry, ScopeData& scope);
+	void DumpAllocations(EventStorage& entry, ScopeData& scope);
+	void DumpLocks(EventStorage& entry, ScopeData& scope);
+	void DumpFlows(EventStorage& entry, ScopeData& scope);
+	void DumpAsyncEvents(EventStorage& entry, const EventTime& timeSlice, ScopeData& scope);
 	void DumpThread(ThreadEntry& entry, const EventTime& timeSlice, ScopeData& scope);
 	void DumpFiber(FiberEntry& entry, const EventTime& timeSlice, ScopeData& scope);
 
@@ -523,6 +867,12 @@ class Core
 	void DumpBoard(uint32 mode, EventTime timeSlice);
 
 	void GenerateCommonSummary();
+	void GenerateHWCountersSummary();
+	void GenerateCPUTimeSummary();
+	void GenerateCountersSummary();
+	void GenerateAllocationsSummary();
+	void GenerateLocksSummary();
+	void GenerateFlowsSummary();
 public:
 	void Activate(Mode::Type mode);
 	volatile Mode::Type currentMode;
@@ -543,6 +893,12 @@ public:
 	// SysCall Collector
 	SysCallCollector syscallCollector;
 
+	// Tags for the hardware counters deltas
+	array<const EventDescription*, HWCounterValues::COUNT> hwCounterDescriptions;
+
+	// Tag for the thread CPU time
+	const EventDescription* cpuTimeDescription;
+
 	// GPU Profiler
 	GPUProfiler* gpuProfiler;
 
@@ -564,6 +920,9 @@ public:
 	// Report switch context event
 	bool ReportSwitchContext(const SwitchContextDesc& desc);
 
+	// Report wake up event (waker -> wakee)
+	bool ReportWakeup(const WakeupDesc& desc);
+
 	// Report switch context event
 	bool ReportStackWalk(const CallstackDesc& desc);
 
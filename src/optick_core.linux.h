@@ -27,13 +27,33 @@
 #if USE_OPTICK
 
 #include "optick_core.platform.h"
+#include "optick_core.posix.h"
 
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <cxxabi.h>
+#include <dirent.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <linux/perf_event.h>
+#include <poll.h>
 #include <pthread.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <ucontext.h>
 #include <unistd.h>
 
+// Older glibc doesn't expose SIGEV_THREAD_ID target
+#if !defined(sigev_notify_thread_id)
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
 namespace Optick
 {
 	const char* Platform::GetName() 
@@ -66,11 +86,37 @@ namespace Optick
 		clock_gettime(CLOCK_MONOTONIC, &ts);
 		return ts.tv_sec * 1000000000LL + ts.tv_nsec;
 	}
+
+	int64 Platform::GetThreadCPUTime()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	}
+
+	bool Platform::GetThreadStack(uint64& begin, uint64& end)
+	{
+		pthread_attr_t attr;
+		if (pthread_getattr_np(pthread_self(), &attr) != 0)
+			return false;
+
+		void* stackAddress = nullptr;
+		size_t stackSize = 0;
+		bool result = pthread_attr_getstack(&attr, &stackAddress, &stackSize) == 0 && stackSize > 0;
+		if (result)
+		{
+			begin = (uint64)stackAddress;
+			end = (uint64)stackAddress + stackSize;
+		}
+		pthread_attr_destroy(&attr);
+		return result;
+	}
 }
 
 #if OPTICK_ENABLE_TRACING
 
 #include "optick_memory.h"
+#include "optick_miniz.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 namespace ft
@@ -122,6 +168,235 @@ namespace ft
 		int next_prio;
 	};
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Field description from the tracefs "format" files
+	// 	field:pid_t prev_pid;	offset:24;	size:4;	signed:1;
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct field
+	{
+		uint32_t offset;
+		uint32_t size;
+
+		field(uint32_t o = 0, uint32_t s = 0) : offset(o), size(s) {}
+		bool is_valid() const { return size > 0; }
+
+		bool parse(const char* format, const char* name)
+		{
+			size_t nameLength = strlen(name);
+
+			for (const char* line = strstr(format, "field:"); line != nullptr; line = strstr(line + 1, "field:"))
+			{
+				const char* end = strchr(line, ';');
+				if (end == nullptr)
+					return false;
+
+				// Skipping array size: "char prev_comm[16];"
+				const char* finish = end;
+				if (const char* bracket = (const char*)memchr(line, '[', end - line))
+					finish = bracket;
+
+				const char* start = finish - nameLength;
+				if (start > line && start[-1] == ' ' && strncmp(start, name, nameLength) == 0)
+				{
+					const char* offsetText = strstr(end, "offset:");
+					const char* sizeText = strstr(end, "size:");
+					if (offsetText == nullptr || sizeText == nullptr)
+						return false;
+
+					offset = (uint32_t)atoi(offsetText + strlen("offset:"));
+					size = (uint32_t)atoi(sizeText + strlen("size:"));
+					return true;
+				}
+			}
+			return false;
+		}
+
+		int64_t read_int(const uint8_t* data) const
+		{
+			switch (size)
+			{
+			case 1: return *(const int8_t*)(data + offset);
+			case 2: { int16_t val; memcpy(&val, data + offset, sizeof(val)); return val; }
+			case 4: { int32_t val; memcpy(&val, data + offset, sizeof(val)); return val; }
+			case 8: { int64_t val; memcpy(&val, data + offset, sizeof(val)); return val; }
+			}
+			return 0;
+		}
+
+		void read_string(const uint8_t* data, char* output, size_t count) const
+		{
+			size_t length = std::min(count - 1, (size_t)size);
+			memcpy(output, data + offset, length);
+			output[length] = '\0';
+		}
+	};
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Layout of the ring buffer page (events/header_page)
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct header_page
+	{
+		field timestamp;
+		field commit;
+		field data;
+
+		header_page() : timestamp(0, 8), commit(8, sizeof(long)), data(8 + sizeof(long), 0) {}
+
+		void parse(const char* format)
+		{
+			timestamp.parse(format, "timestamp");
+			commit.parse(format, "commit");
+			data.parse(format, "data");
+		}
+	};
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Layout of the sched_switch record (events/sched/sched_switch/format)
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct sched_switch_format
+	{
+		int id;
+		field common_type;
+		field prev_comm;
+		field prev_pid;
+		field prev_prio;
+		field prev_state;
+		field next_comm;
+		field next_pid;
+		field next_prio;
+
+		// Preempted (still runnable) tasks report the bit right above the highest state of the __print_flags table:
+		// TASK_REPORT_MAX on 4.14+ (0x80 or 0x100 depending on TASK_REPORT_IDLE), TASK_STATE_MAX on the older kernels
+		int64_t preempted_mask;
+
+		sched_switch_format() : id(-1), preempted_mask(0) {}
+
+		static int64_t parse_preempted_mask(const char* format)
+		{
+			const char* flags = strstr(format, "__print_flags");
+			if (flags == nullptr)
+				return 0;
+
+			// { 0x00000001, "S" }, { 0x00000002, "D" }, ...
+			int64_t maxFlag = 0;
+			for (const char* entry = strchr(flags, '{'); entry != nullptr; entry = strchr(entry + 1, '{'))
+				maxFlag = std::max(maxFlag, (int64_t)strtoll(entry + 1, nullptr, 0));
+
+			return maxFlag << 1;
+		}
+
+		bool parse(const char* format)
+		{
+			const char* idText = strstr(format, "ID:");
+			if (idText == nullptr)
+				return false;
+
+			id = atoi(idText + strlen("ID:"));
+			preempted_mask = parse_preempted_mask(format);
+
+			return common_type.parse(format, "common_type")
+				&& prev_comm.parse(format, "prev_comm")
+				&& prev_pid.parse(format, "prev_pid")
+				&& prev_prio.parse(format, "prev_prio")
+				&& prev_state.parse(format, "prev_state")
+				&& next_comm.parse(format, "next_comm")
+				&& next_pid.parse(format, "next_pid")
+				&& next_prio.parse(format, "next_prio");
+		}
+
+		process_state::type decode_state(int64_t state) const
+		{
+			if (state & preempted_mask) return process_state::Running;
+
+			// TASK_* bits from include/linux/sched.h (unknown layout: preempted tasks report a bit above TASK_REPORT)
+			if (state & 0x01) return process_state::InterruptibleSleep;
+			if (state & 0x02) return process_state::UninterruptibleSleep;
+			if (state & 0x0C) return process_state::Stopped;
+			if (state & 0x10) return process_state::Dead;
+			if (state & 0x20) return process_state::Zombie;
+			if ((state & 0xFF) == 0) return process_state::Running;
+			return process_state::Unknown;
+		}
+	};
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Layout of the sched_waking\sched_wakeup records (events/sched/sched_waking/format)
+	// common_pid is the waker (sched_waking is always reported from the context of the waker)
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct sched_wakeup_format
+	{
+		int id;
+		field common_type;
+		field common_pid;
+		field pid;
+		field target_cpu;
+
+		sched_wakeup_format() : id(-1) {}
+
+		bool parse(const char* format)
+		{
+			const char* idText = strstr(format, "ID:");
+			if (idText == nullptr)
+				return false;
+
+			id = atoi(idText + strlen("ID:"));
+
+			return common_type.parse(format, "common_type")
+				&& common_pid.parse(format, "common_pid")
+				&& pid.parse(format, "pid")
+				&& target_cpu.parse(format, "target_cpu");
+		}
+
+		bool match(const uint8_t* data, size_t size) const
+		{
+			return id >= 0
+				&& size >= pid.offset + pid.size
+				&& size >= target_cpu.offset + target_cpu.size
+				&& common_type.read_int(data) == id;
+		}
+	};
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Layout of the raw_syscalls records (events/raw_syscalls/sys_enter/format, events/raw_syscalls/sys_exit/format)
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct raw_syscall_format
+	{
+		int id;
+		field common_type;
+		field common_pid;
+		field syscall_id;
+
+		raw_syscall_format() : id(-1) {}
+
+		bool parse(const char* format)
+		{
+			const char* idText = strstr(format, "ID:");
+			if (idText == nullptr)
+				return false;
+
+			id = atoi(idText + strlen("ID:"));
+
+			return common_type.parse(format, "common_type")
+				&& common_pid.parse(format, "common_pid")
+				&& syscall_id.parse(format, "id");
+		}
+
+		bool match(const uint8_t* data, size_t size) const
+		{
+			return id >= 0
+				&& size >= common_pid.offset + common_pid.size
+				&& size >= syscall_id.offset + syscall_id.size
+				&& common_type.read_int(data) == id;
+		}
+	};
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Record types of the kernel ring buffer (kernel/trace/ring_buffer.c)
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct ring_buffer_event
+	{
+		static const uint32_t TYPE_DATA_MAX = 28;
+		static const uint32_t TYPE_PADDING = 29;
+		static const uint32_t TYPE_TIME_EXTEND = 30;
+		static const uint32_t TYPE_TIME_STAMP = 31;
+		static const uint32_t TIME_SHIFT = 27;
+		static const uint64_t COMMIT_MASK = (1 << 27) - 1;
+	};
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 } // namespace ft
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -133,311 +408,3248 @@ static const char* FTRACE_TRACE = "trace";
 static const char* FTRACE_TRACING_ON = "tracing_on";
 static const char* FTRACE_TRACE_CLOCK = "trace_clock";
 static const char* FTRACE_OPTIONS_IRQ_INFO = "options/irq-info";
+static const char* FTRACE_BUFFER_PERCENT = "buffer_percent";
+static const char* FTRACE_HEADER_PAGE = "events/header_page";
 static const char* FTRACE_SCHED_SWITCH = "events/sched/sched_switch/enable";
+static const char* FTRACE_SCHED_SWITCH_FORMAT = "events/sched/sched_switch/format";
+static const char* FTRACE_SCHED_WAKING = "events/sched/sched_waking/enable";
+static const char* FTRACE_SCHED_WAKING_FORMAT = "events/sched/sched_waking/format";
+static const char* FTRACE_SCHED_WAKEUP = "events/sched/sched_wakeup/enable";
+static const char* FTRACE_SCHED_WAKEUP_FORMAT = "events/sched/sched_wakeup/format";
+static const char* FTRACE_PER_CPU_TRACE_PIPE_RAW = "per_cpu/cpu%d/trace_pipe_raw";
+static const char* FTRACE_RAW_SYSCALLS = "events/raw_syscalls/enable";
+static const char* FTRACE_RAW_SYSCALLS_FILTER = "events/raw_syscalls/filter";
+static const char* FTRACE_SYS_ENTER_FORMAT = "events/raw_syscalls/sys_enter/format";
+static const char* FTRACE_SYS_EXIT_FORMAT = "events/raw_syscalls/sys_exit/format";
+static const int FTRACE_POLL_TIMEOUT_MS = 100;
+static const size_t FTRACE_SYSCALL_FILTER_MAX_THREADS = 64; // Keeps the filter well below the page size limit of the kernel
 static const uint8_t PROCESS_STATE_REASON_START = 38;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-class FTrace : public Trace
+static const char* PERF_EVENT_PARANOID = "/proc/sys/kernel/perf_event_paranoid";
+static const char* PERF_TRACING_PATHS[] = { "/sys/kernel/tracing", "/sys/kernel/debug/tracing" };
+static const char* PERF_SCHED_SWITCH_FORMAT = "events/sched/sched_switch/format";
+static const char* PERF_SCHED_WAKING_FORMAT = "events/sched/sched_waking/format";
+static const char* PERF_SCHED_WAKEUP_FORMAT = "events/sched/sched_wakeup/format";
+static const char* PERF_SYS_ENTER_FORMAT = "events/raw_syscalls/sys_enter/format";
+static const char* PERF_SYS_EXIT_FORMAT = "events/raw_syscalls/sys_exit/format";
+static const size_t PERF_BUFFER_PAGE_COUNT = 128; // 512Kb per CPU
+static const size_t PERF_SAMPLER_PAGE_COUNT = 32; // 128Kb per thread
+static const size_t PERF_SAMPLER_MAX_DEPTH = 255; // CallstackDesc::count is uint8
+static const size_t PERF_SYSCALL_PAGE_COUNT = 32; // 128Kb per thread and event
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const uint32 SIGNAL_SAMPLER_MAX_THREAD_COUNT = 256;
+static const uint32 SIGNAL_SAMPLER_BUFFER_SIZE = 1 << 17; // 1Mb per thread
+static const uint32 SIGNAL_SAMPLER_MAX_DEPTH = 255; // CallstackDesc::count is uint8
+static const uintptr_t SIGNAL_SAMPLER_MAX_STACK_SIZE = 64 << 20;
+static const size_t RUN_QUEUE_MAX_THREAD_TRACKS = 64; // Shared descriptions are never freed (thread pools spawn new tids all the time)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Set of perf events with mmap'd ring buffers, drained by a background thread
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class PerfReader
 {
-	bool isActive;
-	string password;
-	unordered_set<pid_t> pidCache;
+public:
+	struct Buffer
+	{
+		int fd;
+		int cpu;
+		perf_event_mmap_page* header;
+		uint8_t* data;
+		size_t size;
 
-	bool Parse(const char* line);
-	bool ProcessEvent(const ft::base_event& ev);
+		Buffer() : fd(-1), cpu(-1), header(nullptr), data(nullptr), size(0) {}
+	};
 
-	bool Set(const char* name, bool value);
-	bool Set(const char* name, const char* value);
-	bool Exec(const char* cmd);
-public:
+	typedef void(*SampleCb)(void* context, const Buffer& buffer, const uint8_t* record, size_t size);
 
-	FTrace();
-	~FTrace();
+	PerfReader(SampleCb cb, void* context) : sampleCb(cb), sampleContext(context), isReading(false) {}
+	~PerfReader() { Stop(); }
 
-	virtual void SetPassword(const char* pwd) override { password = pwd; }
-	virtual CaptureStatus::Type Start(Mode::Type mode, int frequency, const ThreadList& threads) override;
-	virtual bool Stop() override;
+	bool Open(perf_event_attr& attr, pid_t pid, int cpu, size_t pageCount);
+	bool Start();
+	void Stop();
+
+	bool IsEmpty() const { return buffers.empty(); }
+private:
+	SampleCb sampleCb;
+	void* sampleContext;
+
+	vector<Buffer> buffers;
+	vector<uint8_t> scratch;
+
+	// Events opened while the reader thread is running
+	std::mutex pendingLock;
+	vector<Buffer> pendingBuffers;
+
+	std::thread readerThread;
+	std::atomic<bool> isReading;
+
+	bool Read(Buffer& buffer);
+	bool AddPending();
+	void ReaderThread();
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-struct Parser
+// Periodic sampling of the registered threads (Mode::AUTOSAMPLING)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class PerfSampler
 {
-	const char* cursor;
-	const char* finish;
-	size_t length;
+	PerfReader reader;
+	perf_event_attr attr;
+	bool isActive;
 
-	Parser(const char* b) : cursor(b), finish(b + strlen(b)) {}
+	static void OnSample(void* context, const PerfReader::Buffer& buffer, const uint8_t* record, size_t size);
+public:
+	PerfSampler() : reader(&PerfSampler::OnSample, this), isActive(false) {}
 
-	bool Skip(size_t count)
+	CaptureStatus::Type Start(int frequency, const ThreadList& threads);
+	void AddThread(const ThreadEntry* entry);
+	void Stop();
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// In-process sampling with SIGPROF (fallback for the hosts which forbid perf_event_open)
+// Every thread gets a timer ticking in its own CPU time, the signal handler walks the frame pointers
+// into a preallocated per-thread buffer which is drained into the CallstackCollector on Stop.
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class SignalSampler
+{
+	struct ThreadBuffer
 	{
-		if ((size_t)(finish - cursor) > count)
-		{
-			cursor += count;
-			return true;
-		}
-		return false;
-	}
+		pid_t threadID;
+		timer_t timer;
+		bool hasTimer;
+
+		// Stack bounds (recorded by RegisterThread, zero for the threads with unknown bounds)
+		uintptr_t stackBegin;
+		uintptr_t stackEnd;
+
+		// Packed records: {Timestamp, Count, Callstack[Count]}
+		uint64* data;
+		std::atomic<uint32> size;
+		std::atomic<uint32> dropped;
+	};
 
-	bool Skip(const char* text, char* output = nullptr, size_t size = 0)
-	{
-		if (const char* ptr = strstr(cursor, text))
-		{
-			if (output != nullptr)
-			{
-				size_t count = std::min(size - 1, (size_t)(ptr - cursor));
-				strncpy(output, cursor, count);
-				output[count] = '\0';
-			}
-			cursor = ptr + strlen(text);
-			return true;
-		}
-		return false;
-	}
+	ThreadBuffer threads[SIGNAL_SAMPLER_MAX_THREAD_COUNT];
+	std::atomic<uint32> threadCount;
+	int64 period;
+	bool isActive;
 
-	void SkipSpaces()
-	{
-		while (cursor != finish && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n'))
-			++cursor;
-	}
+	static std::atomic<SignalSampler*> instance;
+	static std::atomic<int> activeHandlers;
 
-	bool Starts(const char* text) const
-	{
-		return strncmp(cursor, text, strlen(text)) == 0;
-	}
+	// Set from the handler when process_vm_readv is forbidden (seccomp), reported on Stop
+	static std::atomic<bool> isRemoteReadDenied;
 
-	int GetInt() const
-	{
-		return atoi(cursor);
-	}
+	bool AddThread(pid_t threadID, uintptr_t stackBegin, uintptr_t stackEnd);
+	void Drain(ThreadBuffer& buffer);
 
-	char GetChar() const
-	{
-		return *cursor;
-	}
+	static void OnSignal(int signo, siginfo_t* info, void* context);
+	static uint32 Unwind(const ThreadBuffer& buffer, const ucontext_t* context, uint64* callstack, uint32 maxCount);
+	static bool ReadFrame(const ThreadBuffer& buffer, uintptr_t address, uintptr_t frame[2]);
+public:
+	SignalSampler() : threadCount(0), period(0), isActive(false) {}
+	~SignalSampler() { Stop(); }
+
+	CaptureStatus::Type Start(int frequency, const ThreadList& threads);
+	void AddThread(const ThreadEntry* entry);
+	void Stop();
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-CaptureStatus::Type FTrace::Start(Mode::Type mode, int /*frequency*/, const ThreadList& /*threads*/)
+// Resolves foreign thread ids into their owning processes through /proc (Mode::OTHER_PROCESSES)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ProcessScanner
 {
-	if (!isActive)
-	{
-		// Disable tracing
-		if (!Set(FTRACE_TRACING_ON, false)) 
-			return CaptureStatus::ERR_TRACER_INVALID_PASSWORD;
+	unordered_map<pid_t, pid_t> threadToProcess;
+	unordered_set<pid_t> registeredProcesses;
+	bool isActive;
 
-		// Cleanup old data
-		Set(FTRACE_TRACE, "");
-		// Set clock type
-		Set(FTRACE_TRACE_CLOCK, "mono");
-		// Disable irq info
-		Set(FTRACE_OPTIONS_IRQ_INFO, false);
-		// Enable switch events
-		Set(FTRACE_SCHED_SWITCH, (mode & Mode::SWITCH_CONTEXT) != 0);
+	static bool ReadFile(const char* path, char* buffer, size_t size, size_t& length);
+	static pid_t ReadProcessID(pid_t tid);
+	static string ReadProcessName(pid_t pid, const char* fallback);
+public:
+	ProcessScanner() : isActive(false) {}
 
-		// Enable tracing
-		Set(FTRACE_TRACING_ON, true);
+	bool IsActive() const { return isActive; }
 
-		isActive = true;
-	}
+	// Collects tid => tgid pairs for all the threads alive at the moment of the call
+	void Start();
+	void Stop();
 
-	return CaptureStatus::OK;
-}
+	// Registers thread (and the owning process on the first occurrence)
+	void Register(pid_t tid, const char* threadName, int priority);
+};
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool FTrace::Stop()
+// Common part of the Linux tracers: decoding of the raw sched_switch records
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class KernelTrace : public Trace
 {
-	if (!isActive)
-	{
-		return false;
-	}
+protected:
+	unordered_set<pid_t> pidCache;
+	ft::sched_switch_format switchFormat;
 
-	// Reset variables
-	Set(FTRACE_TRACING_ON, false);
-	Set(FTRACE_SCHED_SWITCH, false);
+	ProcessScanner processScanner;
+
+	PerfSampler sampler;
+	SignalSampler signalSampler;
 
-	// Parsing the output
-	char buffer[256] = { 0 };
-	sprintf_s(buffer, "echo \'%s\' | sudo -S sh -c \'cat %s/%s\'", password.c_str(), KERNEL_TRACING_PATH, FTRACE_TRACE);
-	if (FILE* pipe = popen(buffer, "r"))
+	// Enter and exit records of the same call might come from different buffers (thread migrates to another CPU)
+	struct SysCallEvent
 	{
-		char* line = NULL;
-		size_t len = 0;
-		while ((getline(&line, &len, pipe)) != -1)
-			Parse(line);
-		pclose(pipe);
-	}
+		int64 timestamp;
+		uint32 threadID;
+		int32 id;
+		bool isExit;
+	};
 
-	// Cleanup data
-	Set(FTRACE_TRACE, "");
+	ft::raw_syscall_format sysEnterFormat;
+	ft::raw_syscall_format sysExitFormat;
+	vector<SysCallEvent> syscallEvents;
 
-	pidCache.clear();
+	// Threads traced for the system calls, records of the other threads are dropped (empty - no filtering)
+	unordered_set<pid_t> syscallThreads;
 
-	isActive = false;
+	// sched_waking (sched_wakeup on the kernels older than 4.3)
+	ft::sched_wakeup_format wakeupFormat;
 
-	return true;
-}
+	CaptureStatus::Type StartSampling(int frequency, const ThreadList& threads);
+	void StopSampling();
+
+	// Pairs enter\exit records into SysCallData (called after the readers are stopped)
+	void FlushSysCalls();
+
+	void ParseEvent(int cpu, int64 timestamp, const uint8_t* data, size_t size);
+	bool ProcessEvent(const ft::base_event& ev);
+public:
+	virtual void AddThread(const ThreadEntry* entry) override;
+};
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool FTrace::Parse(const char * line)
+class FTrace : public KernelTrace
 {
-	// sched_switch:      
-	//	   ConsoleApp-8687  [000]  181944.352057: sched_switch: prev_comm=ConsoleApp prev_pid=8687 prev_prio=120 prev_state=S ==> next_comm=ConsoleApp next_pid=8686 next_prio=120
+	// Reads binary pages of the per-cpu ring buffer through the privileged "cat" process
+	struct Reader
+	{
+		FILE* pipe;
+		int pid;
+		int cpu;
+		vector<uint8_t> page;
+		size_t pageSize;
 
-	Parser p(line);
-	if (p.Starts("#"))
-		return true;
+		Reader() : pipe(nullptr), pid(0), cpu(0), pageSize(0) {}
+	};
 
-	if (!p.Skip(16))
-		return false;
+	bool isActive;
+	string password;
 
-	if (!p.Skip("["))
-		return false;
+	ft::header_page headerPage;
 
-	int cpu = p.GetInt();
-	if (!p.Skip("]"))
-		return false;
+	// Enabled wake up event (nullptr if the kernel doesn't provide any)
+	const char* wakeupEvent;
 
-	int64 timestampInt = p.GetInt();
-	if (!p.Skip("."))
-		return false;
+	// Threads registered during the capture, the filter is updated by the reader thread
+	vector<pid_t> pendingSysCallThreads;
+	std::mutex pendingSysCallThreadsLock;
+	std::atomic<bool> hasPendingSysCallThreads;
 
-	int64 timestampFraq = p.GetInt();
-	if (!p.Skip(": "))
-		return false;
+	bool isSysCallsActive;
+	bool SetSysCallFilter();
+	void UpdateSysCallFilter();
 
-	int64 timestamp = ((timestampInt * 1000000) + timestampFraq) * 1000;
+	vector<Reader> readers;
+	std::thread readerThread;
+	std::atomic<bool> isReading;
 
-	if (p.Starts("sched_switch:"))
-	{
-		ft::sched_switch ev;
-		ev.cpu_id = cpu;
-		ev.timestamp = timestamp;
+	bool OpenReaders();
+	void CloseReaders();
+	bool ReadPipe(Reader& reader);
+	void ReaderThread();
 
-		if (!p.Skip("prev_comm="))
-			return false;
+	void ParsePage(const Reader& reader);
 
-		if (!p.Skip(" prev_pid=", ev.prev_comm, OPTICK_ARRAY_SIZE(ev.prev_comm)))
-			return false;
+	bool Set(const char* name, bool value);
+	bool Set(const char* name, const char* value);
+	bool Read(const char* name, string& output);
+	bool Exec(const char* cmd);
+	FILE* Open(const char* cmd);
+public:
 
-		ev.prev_pid = p.GetInt();
+	FTrace();
+	~FTrace();
 
-		if (!p.Skip(" prev_prio="))
-			return false;
+	virtual void SetPassword(const char* pwd) override { password = pwd; }
+	virtual CaptureStatus::Type Start(Mode::Type mode, int frequency, const ThreadList& threads) override;
+	virtual bool Stop() override;
+	virtual void AddThread(const ThreadEntry* entry) override;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scheduler tracing through perf_event_open (doesn't need sudo or debugfs write access)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class PerfTrace : public KernelTrace
+{
+	bool isActive;
+	bool isSysCallsActive;
+	PerfReader reader;
 
-		ev.prev_prio = p.GetInt();
+	static void OnSample(void* context, const PerfReader::Buffer& buffer, const uint8_t* record, size_t size);
 
-		if (!p.Skip(" prev_state="))
-			return false;
+	bool StartSysCalls(const ThreadList& threads);
+	void OpenSysCalls(pid_t threadID);
 
-		switch (p.GetChar())
-		{
-		case 'D':
-			ev.prev_state = ft::process_state::UninterruptibleSleep;
-			break;
+	static int OpenEvent(int tracepoint, int cpu);
+	static void InitAttributes(perf_event_attr& attr, int tracepoint);
+	static bool ReadFormat(const char* name, string& output);
+	static int GetTracepointID();
+public:
+	PerfTrace();
+	~PerfTrace();
 
-		case 'R':
-			ev.prev_state = ft::process_state::Running;
-			break;
+	static bool IsAvailable();
 
-		case 'S':
-			ev.prev_state = ft::process_state::InterruptibleSleep;
-			break;
+	virtual CaptureStatus::Type Start(Mode::Type mode, int frequency, const ThreadList& threads) override;
+	virtual bool Stop() override;
+	virtual void AddThread(const ThreadEntry* entry) override;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::atomic<SignalSampler*> SignalSampler::instance(nullptr);
+std::atomic<int> SignalSampler::activeHandlers(0);
+std::atomic<bool> SignalSampler::isRemoteReadDenied(false);
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureStatus::Type SignalSampler::Start(int frequency, const ThreadList& entries)
+{
+	if (isActive)
+		return CaptureStatus::OK;
 
-		case 'T':
-			ev.prev_state = ft::process_state::Stopped;
-			break;
+	// The handler stays installed: a pending signal must never hit the default action (termination)
+	static bool isHandlerInstalled = false;
+	if (!isHandlerInstalled)
+	{
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = &SignalSampler::OnSignal;
+		action.sa_flags = SA_SIGINFO | SA_RESTART;
+		sigemptyset(&action.sa_mask);
 
-		case 'X':
-			ev.prev_state = ft::process_state::Dead;
-			break;
+		if (sigaction(SIGPROF, &action, nullptr) != 0)
+			return CaptureStatus::ERR_TRACER_FAILED;
 
-		case 'Z':
-			ev.prev_state = ft::process_state::Zombie;
-			break;
+		isHandlerInstalled = true;
+	}
 
-		default:
-			ev.prev_state = ft::process_state::Unknown;
-			break;
-		}
+	period = 1000000000LL / std::max(frequency, 1);
+	threadCount = 0;
+	isRemoteReadDenied = false;
+	instance = this;
+	isActive = true;
 
-		if (!p.Skip("==> next_comm="))
-			return false;
+	for (const ThreadEntry* entry : entries)
+		if (entry->isAlive)
+			AddThread((pid_t)entry->description.threadID, (uintptr_t)entry->stackBegin, (uintptr_t)entry->stackEnd);
 
-		if (!p.Skip(" next_pid=", ev.next_comm, OPTICK_ARRAY_SIZE(ev.prev_comm)))
-			return false;
+	return CaptureStatus::OK;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SignalSampler::AddThread(const ThreadEntry* entry)
+{
+	if (isActive)
+		AddThread((pid_t)entry->description.threadID, (uintptr_t)entry->stackBegin, (uintptr_t)entry->stackEnd);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SignalSampler::AddThread(pid_t threadID, uintptr_t stackBegin, uintptr_t stackEnd)
+{
+	uint32 index = threadCount.load();
+	if (index >= SIGNAL_SAMPLER_MAX_THREAD_COUNT)
+		return false;
 
-		ev.next_pid = p.GetInt();
+	ThreadBuffer& buffer = threads[index];
+	buffer.threadID = threadID;
+	buffer.hasTimer = false;
+	buffer.stackBegin = stackBegin;
+	buffer.stackEnd = stackEnd;
+	buffer.size = 0;
+	buffer.dropped = 0;
+	buffer.data = (uint64*)Memory::Alloc(SIGNAL_SAMPLER_BUFFER_SIZE * sizeof(uint64));
 
-		if (!p.Skip(" next_prio="))
-			return false;
+	// Publishing the buffer before the first signal arrives
+	threadCount = index + 1;
+
+	// CPU-time clock of the thread: MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED) from the kernel
+	clockid_t clock = (clockid_t)((~(unsigned int)threadID) << 3) | 6;
+
+	sigevent event;
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+	event.sigev_notify_thread_id = threadID;
 
-		ev.next_prio = p.GetInt();
+	if (timer_create(clock, &event, &buffer.timer) != 0)
+		return false;
+
+	itimerspec interval;
+	interval.it_interval.tv_sec = period / 1000000000LL;
+	interval.it_interval.tv_nsec = period % 1000000000LL;
+	interval.it_value = interval.it_interval;
 
-		return ProcessEvent(ev);
+	if (timer_settime(buffer.timer, 0, &interval, nullptr) != 0)
+	{
+		timer_delete(buffer.timer);
+		return false;
 	}
+
+	buffer.hasTimer = true;
 	return true;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool FTrace::ProcessEvent(const ft::base_event& ev)
+void SignalSampler::Stop()
 {
-	switch (ev.common_type)
-	{
-	case ft::sched_switch::type:
+	if (!isActive)
+		return;
+
+	uint32 count = threadCount.load();
+
+	for (uint32 i = 0; i < count; ++i)
+		if (threads[i].hasTimer)
+			timer_delete(threads[i].timer);
+
+	// Waiting for the handlers which are still running
+	instance = nullptr;
+	while (activeHandlers.load() > 0)
+		std::this_thread::yield();
+
+	for (uint32 i = 0; i < count; ++i)
 	{
-		const ft::sched_switch& switchEv = (const ft::sched_switch&)ev;
-		SwitchContextDesc desc;
-		desc.reason = switchEv.prev_state + PROCESS_STATE_REASON_START;
-		desc.cpuId = switchEv.cpu_id;
-		desc.oldThreadId = (uint64)switchEv.prev_pid;
-		desc.newThreadId = (uint64)switchEv.next_pid;
-		desc.timestamp = switchEv.timestamp;
-		Core::Get().ReportSwitchContext(desc);
+		Drain(threads[i]);
+		Memory::Free(threads[i].data);
+		threads[i].data = nullptr;
+	}
 
-		if (pidCache.find(switchEv.next_pid) == pidCache.end())
+	threadCount = 0;
+	isActive = false;
+
+	if (isRemoteReadDenied.exchange(false))
+		Core::Get().AttachSummary("Sampling Warning", "process_vm_readv is not permitted: callstacks of the threads with unknown stack bounds are truncated to the current PC");
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SignalSampler::Drain(ThreadBuffer& buffer)
+{
+	uint32 size = buffer.size.load(std::memory_order_acquire);
+
+	for (uint32 index = 0; index + 2 <= size;)
+	{
+		CallstackDesc desc;
+		desc.threadID = (uint64)buffer.threadID;
+		desc.timestamp = buffer.data[index];
+		desc.count = (uint8)buffer.data[index + 1];
+		desc.callstack = &buffer.data[index + 2];
+		index += 2 + desc.count;
+
+		if (desc.count > 0 && index <= size)
+			Core::Get().ReportStackWalk(desc);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SignalSampler::OnSignal(int /*signo*/, siginfo_t* /*info*/, void* context)
+{
+	// Async-signal-safe: no locks, no allocations, no libc calls except syscall and clock_gettime
+	int savedErrno = errno;
+	++activeHandlers;
+
+	if (SignalSampler* sampler = instance.load())
+	{
+		pid_t threadID = (pid_t)syscall(SYS_gettid);
+		uint32 count = sampler->threadCount.load(std::memory_order_acquire);
+
+		for (uint32 i = 0; i < count; ++i)
 		{
-			pidCache.insert(switchEv.next_pid);
-			Core::Get().RegisterThreadDescription(ThreadDescription(switchEv.next_comm, (ThreadID)switchEv.next_pid, (ProcessID)switchEv.next_pid, switchEv.next_prio));
+			ThreadBuffer& buffer = sampler->threads[i];
+			if (buffer.threadID != threadID)
+				continue;
+
+			// Only the owner thread writes into the buffer (SIGPROF is blocked while the handler is running)
+			uint32 size = buffer.size.load(std::memory_order_relaxed);
+			uint32 available = SIGNAL_SAMPLER_BUFFER_SIZE - size;
+
+			if (available < 3)
+			{
+				++buffer.dropped;
+				break;
+			}
+
+			uint64* record = buffer.data + size;
+			uint32 depth = Unwind(buffer, (const ucontext_t*)context, record + 2, std::min<uint32>(available - 2, SIGNAL_SAMPLER_MAX_DEPTH));
+			record[0] = (uint64)Platform::GetTime();
+			record[1] = depth;
+
+			buffer.size.store(size + 2 + depth, std::memory_order_release);
+			break;
 		}
+	}
+
+	--activeHandlers;
+	errno = savedErrno;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SignalSampler::ReadFrame(const ThreadBuffer& buffer, uintptr_t address, uintptr_t frame[2])
+{
+	if (buffer.stackEnd != 0)
+	{
+		if (address < buffer.stackBegin || address + 2 * sizeof(uintptr_t) > buffer.stackEnd)
+			return false;
 
+		frame[0] = ((const uintptr_t*)address)[0];
+		frame[1] = ((const uintptr_t*)address)[1];
 		return true;
 	}
-	break;
-	}
+
+	// Unknown stack bounds: reading through the kernel which fails gracefully on unmapped memory
+	if (isRemoteReadDenied.load(std::memory_order_relaxed))
+		return false;
+
+	iovec local = { frame, 2 * sizeof(uintptr_t) };
+	iovec remote = { (void*)address, 2 * sizeof(uintptr_t) };
+	if (process_vm_readv(getpid(), &local, 1, &remote, 1, 0) == (ssize_t)(2 * sizeof(uintptr_t)))
+		return true;
+
+	if (errno == EPERM || errno == ENOSYS)
+		isRemoteReadDenied = true;
 
 	return false;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool FTrace::Set(const char * name, bool value)
+uint32 SignalSampler::Unwind(const ThreadBuffer& buffer, const ucontext_t* context, uint64* callstack, uint32 maxCount)
 {
-	return Set(name, value ? "1" : "0");
+	if (maxCount == 0)
+		return 0;
+
+#if defined(__x86_64__)
+	uintptr_t pc = (uintptr_t)context->uc_mcontext.gregs[REG_RIP];
+	uintptr_t fp = (uintptr_t)context->uc_mcontext.gregs[REG_RBP];
+	uintptr_t sp = (uintptr_t)context->uc_mcontext.gregs[REG_RSP];
+#elif defined(__aarch64__)
+	uintptr_t pc = (uintptr_t)context->uc_mcontext.pc;
+	uintptr_t fp = (uintptr_t)context->uc_mcontext.regs[29];
+	uintptr_t sp = (uintptr_t)context->uc_mcontext.sp;
+#else
+	uintptr_t pc = 0;
+	uintptr_t fp = 0;
+	uintptr_t sp = 0;
+	OPTICK_UNUSED(context);
+	return 0;
+#endif
+
+	uint32 count = 0;
+	callstack[count++] = pc;
+
+	// Frame record: {previous frame pointer, return address}
+	uintptr_t frame[2];
+	while (count < maxCount && fp >= sp && fp - sp < SIGNAL_SAMPLER_MAX_STACK_SIZE && (fp % sizeof(uintptr_t)) == 0)
+	{
+		if (!ReadFrame(buffer, fp, frame) || frame[1] == 0)
+			break;
+
+		callstack[count++] = frame[1];
+
+		// Stack grows down: every caller frame must be above the current one
+		if (frame[0] <= fp)
+			break;
+
+		fp = frame[0];
+	}
+
+	return count;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool FTrace::Set(const char* name, const char* value)
+CaptureStatus::Type KernelTrace::StartSampling(int frequency, const ThreadList& threads)
 {
-	char buffer[256] = { 0 };
-	sprintf_s(buffer, "echo %s > %s/%s", value, KERNEL_TRACING_PATH, name);
-	return Exec(buffer);
+	CaptureStatus::Type status = sampler.Start(frequency, threads);
+
+	// perf_event_open is forbidden - falling back to the signal-based sampler
+	if (status != CaptureStatus::OK)
+		status = signalSampler.Start(frequency, threads);
+
+	return status;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool FTrace::Exec(const char* cmd)
+void KernelTrace::StopSampling()
 {
-	char buffer[256] = { 0 };
-	sprintf_s(buffer, "echo \'%s\' | sudo -S sh -c \'%s\' 2> /dev/null", password.c_str(), cmd);
-	return std::system(buffer) == 0;
+	sampler.Stop();
+	signalSampler.Stop();
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-FTrace::FTrace() : isActive(false)
+bool ProcessScanner::ReadFile(const char* path, char* buffer, size_t size, size_t& length)
 {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	ssize_t result = read(fd, buffer, size - 1);
+	close(fd);
+
+	if (result <= 0)
+		return false;
+
+	length = (size_t)result;
+	buffer[length] = '\0';
+	return true;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-FTrace::~FTrace()
+pid_t ProcessScanner::ReadProcessID(pid_t tid)
 {
-	Stop();
+	// /proc/<tid> is accessible for any thread id, even though it is not listed in /proc
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/status", tid);
+
+	char buffer[1024];
+	size_t length = 0;
+	if (ReadFile(path, buffer, sizeof(buffer), length))
+	{
+		if (const char* tgid = strstr(buffer, "Tgid:"))
+		{
+			pid_t pid = (pid_t)strtol(tgid + 5, nullptr, 10);
+			if (pid > 0)
+				return pid;
+		}
+	}
+	return tid;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-Trace* Platform::CreateTrace()
+string ProcessScanner::ReadProcessName(pid_t pid, const char* fallback)
 {
-	return Memory::New<FTrace>();
+	char path[64];
+	char buffer[512];
+	size_t length = 0;
+
+	// Executable name from the command line (comm is truncated to 15 symbols)
+	snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+	if (ReadFile(path, buffer, sizeof(buffer), length) && buffer[0] != '\0')
+	{
+		const char* name = strrchr(buffer, '/');
+		return name ? name + 1 : buffer;
+	}
+
+	// Kernel threads don't have a command line
+	snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+	if (ReadFile(path, buffer, sizeof(buffer), length))
+	{
+		if (buffer[length - 1] == '\n')
+			buffer[length - 1] = '\0';
+		return buffer;
+	}
+
+	return fallback;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-SymbolEngine* Platform::CreateSymbolEngine()
+void ProcessScanner::Start()
 {
-	return nullptr;
+	isActive = true;
+
+	DIR* procDir = opendir("/proc");
+	if (!procDir)
+		return;
+
+	while (dirent* procEntry = readdir(procDir))
+	{
+		pid_t pid = (pid_t)strtol(procEntry->d_name, nullptr, 10);
+		if (pid <= 0)
+			continue;
+
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/%d/task", pid);
+
+		DIR* taskDir = opendir(path);
+		if (!taskDir)
+			continue;
+
+		while (dirent* taskEntry = readdir(taskDir))
+		{
+			pid_t tid = (pid_t)strtol(taskEntry->d_name, nullptr, 10);
+			if (tid > 0)
+				threadToProcess[tid] = pid;
+		}
+
+		closedir(taskDir);
+	}
+
+	closedir(procDir);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProcessScanner::Stop()
+{
+	threadToProcess.clear();
+	registeredProcesses.clear();
+	isActive = false;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProcessScanner::Register(pid_t tid, const char* threadName, int priority)
+{
+	pid_t pid = tid;
+
+	// Idle task (pid 0) has a separate instance on every CPU and is not visible in /proc
+	if (tid > 0)
+	{
+		auto it = threadToProcess.find(tid);
+		if (it != threadToProcess.end())
+		{
+			pid = it->second;
+		}
+		else
+		{
+			// The thread was started after the scan (falls back to tid if it has already exited)
+			pid = ReadProcessID(tid);
+			threadToProcess[tid] = pid;
+		}
+	}
+
+	if (registeredProcesses.find(pid) == registeredProcesses.end())
+	{
+		registeredProcesses.insert(pid);
+		string name = ReadProcessName(pid, threadName);
+		Core::Get().RegisterProcessDescription(ProcessDescription(name.c_str(), (ProcessID)pid, (uint64)pid));
+	}
+
+	Core::Get().RegisterThreadDescription(ThreadDescription(threadName, (ThreadID)tid, (ProcessID)pid, 1, priority));
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void KernelTrace::AddThread(const ThreadEntry* entry)
+{
+	sampler.AddThread(entry);
+	signalSampler.AddThread(entry);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureStatus::Type FTrace::Start(Mode::Type mode, int frequency, const ThreadList& threads)
+{
+	if (!isActive)
+	{
+		// Sampling doesn't need ftrace (it keeps running even if ftrace is not accessible)
+		if (mode & Mode::AUTOSAMPLING)
+		{
+			CaptureStatus::Type status = StartSampling(frequency, threads);
+			if (status != CaptureStatus::OK)
+				return status;
+		}
+
+		// Disable tracing
+		if (!Set(FTRACE_TRACING_ON, false)) 
+			return CaptureStatus::ERR_TRACER_INVALID_PASSWORD;
+
+		// Cleanup old data
+		Set(FTRACE_TRACE, "");
+		// Set clock type
+		Set(FTRACE_TRACE_CLOCK, "mono");
+		// Disable irq info
+		Set(FTRACE_OPTIONS_IRQ_INFO, false);
+		// Wake up the readers as soon as there is any data (older kernels don't have this option)
+		Set(FTRACE_BUFFER_PERCENT, "0");
+
+		string format;
+		if (Read(FTRACE_HEADER_PAGE, format))
+			headerPage.parse(format.c_str());
+
+		if (mode & Mode::SWITCH_CONTEXT)
+		{
+			if (!Read(FTRACE_SCHED_SWITCH_FORMAT, format) || !switchFormat.parse(format.c_str()))
+				return CaptureStatus::ERR_TRACER_FAILED;
+
+			// Enable switch events
+			Set(FTRACE_SCHED_SWITCH, true);
+
+			if (mode & Mode::OTHER_PROCESSES)
+				processScanner.Start();
+
+			// Wake up events are optional
+			if (Read(FTRACE_SCHED_WAKING_FORMAT, format) && wakeupFormat.parse(format.c_str()))
+				wakeupEvent = FTRACE_SCHED_WAKING;
+			else if (Read(FTRACE_SCHED_WAKEUP_FORMAT, format) && wakeupFormat.parse(format.c_str()))
+				wakeupEvent = FTRACE_SCHED_WAKEUP;
+
+			if (wakeupEvent != nullptr && !Set(wakeupEvent, true))
+				wakeupEvent = nullptr;
+		}
+
+		// System calls are optional (raw_syscalls might be missing in the kernel config)
+		if (mode & Mode::SYS_CALLS)
+		{
+			if (Read(FTRACE_SYS_ENTER_FORMAT, format) && sysEnterFormat.parse(format.c_str()) &&
+				Read(FTRACE_SYS_EXIT_FORMAT, format) && sysExitFormat.parse(format.c_str()))
+			{
+				for (const ThreadEntry* entry : threads)
+					if (entry->isAlive)
+						syscallThreads.insert((pid_t)entry->description.threadID);
+
+				// Tracing only our threads (the filter is updated when a new thread is registered)
+				isSysCallsActive = SetSysCallFilter() && Set(FTRACE_RAW_SYSCALLS, true);
+			}
+		}
+
+		if ((mode & Mode::SWITCH_CONTEXT) || isSysCallsActive)
+		{
+			if (!OpenReaders())
+			{
+				Set(FTRACE_SCHED_SWITCH, false);
+				if (wakeupEvent != nullptr)
+					Set(wakeupEvent, false);
+				wakeupEvent = nullptr;
+				Set(FTRACE_RAW_SYSCALLS, false);
+				isSysCallsActive = false;
+				syscallThreads.clear();
+				return CaptureStatus::ERR_TRACER_FAILED;
+			}
+		}
+
+		// Enable tracing
+		Set(FTRACE_TRACING_ON, true);
+
+		isActive = true;
+	}
+
+	return CaptureStatus::OK;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::Stop()
+{
+	StopSampling();
+
+	if (!isActive)
+	{
+		return false;
+	}
+
+	// Reset variables
+	Set(FTRACE_TRACING_ON, false);
+	Set(FTRACE_SCHED_SWITCH, false);
+
+	if (wakeupEvent != nullptr)
+	{
+		Set(wakeupEvent, false);
+		wakeupEvent = nullptr;
+	}
+
+	if (isSysCallsActive)
+	{
+		Set(FTRACE_RAW_SYSCALLS, false);
+		Set(FTRACE_RAW_SYSCALLS_FILTER, "0");
+		isSysCallsActive = false;
+	}
+
+	// Reader thread drains the ring buffers and exits
+	CloseReaders();
+
+	FlushSysCalls();
+
+	syscallThreads.clear();
+	{
+		std::lock_guard<std::mutex> lock(pendingSysCallThreadsLock);
+		pendingSysCallThreads.clear();
+		hasPendingSysCallThreads = false;
+	}
+
+	// Cleanup data
+	Set(FTRACE_TRACE, "");
+
+	pidCache.clear();
+	processScanner.Stop();
+
+	isActive = false;
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FTrace::AddThread(const ThreadEntry* entry)
+{
+	KernelTrace::AddThread(entry);
+
+	// Called under the threads lock of the Core - writing the filter (sudo) is deferred to the reader thread
+	if (isSysCallsActive)
+	{
+		std::lock_guard<std::mutex> lock(pendingSysCallThreadsLock);
+		pendingSysCallThreads.push_back((pid_t)entry->description.threadID);
+		hasPendingSysCallThreads = true;
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::SetSysCallFilter()
+{
+	if (syscallThreads.empty())
+		return false;
+
+	// Too many threads for the kernel filter - tracing all of them and dropping the foreign records in ParseEvent
+	if (syscallThreads.size() > FTRACE_SYSCALL_FILTER_MAX_THREADS)
+		return Set(FTRACE_RAW_SYSCALLS_FILTER, "0");
+
+	// common_pid == 1234 || common_pid == 1235 || ...
+	string filter = "\"";
+	for (pid_t threadID : syscallThreads)
+	{
+		char condition[40] = { 0 };
+		sprintf_s(condition, "%scommon_pid == %d", filter.size() > 1 ? " || " : "", (int)threadID);
+		filter += condition;
+	}
+	filter += "\"";
+
+	return Set(FTRACE_RAW_SYSCALLS_FILTER, filter.c_str());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FTrace::UpdateSysCallFilter()
+{
+	bool isKernelFiltered = syscallThreads.size() <= FTRACE_SYSCALL_FILTER_MAX_THREADS;
+
+	{
+		std::lock_guard<std::mutex> lock(pendingSysCallThreadsLock);
+		syscallThreads.insert(pendingSysCallThreads.begin(), pendingSysCallThreads.end());
+		pendingSysCallThreads.clear();
+		hasPendingSysCallThreads = false;
+	}
+
+	// One write for the whole batch of the new threads (nothing to update once the kernel filter is off)
+	if (isKernelFiltered)
+		SetSysCallFilter();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::OpenReaders()
+{
+	long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	for (int cpu = 0; cpu < cpuCount; ++cpu)
+	{
+		char path[64] = { 0 };
+		sprintf_s(path, FTRACE_PER_CPU_TRACE_PIPE_RAW, cpu);
+
+		// Reporting pid of the reader first in order to be able to stop it later
+		string cmd = string("echo $$; exec cat ") + KERNEL_TRACING_PATH + "/" + path;
+
+		Reader reader;
+		reader.pipe = Open(cmd.c_str());
+		reader.cpu = cpu;
+		reader.page.resize(pageSize);
+
+		if (reader.pipe == nullptr)
+			continue;
+
+		char digit = 0;
+		while (read(fileno(reader.pipe), &digit, 1) == 1 && digit != '\n')
+			reader.pid = reader.pid * 10 + (digit - '0');
+
+		if (reader.pid == 0)
+		{
+			pclose(reader.pipe);
+			continue;
+		}
+
+		readers.push_back(reader);
+	}
+
+	if (readers.empty())
+		return false;
+
+	isReading = true;
+	readerThread = std::thread(&FTrace::ReaderThread, this);
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FTrace::CloseReaders()
+{
+	if (readers.empty())
+		return;
+
+	isReading = false;
+	if (readerThread.joinable())
+		readerThread.join();
+
+	string cmd = "kill";
+	for (const Reader& reader : readers)
+	{
+		char pid[16] = { 0 };
+		sprintf_s(pid, " %d", reader.pid);
+		cmd += pid;
+	}
+	Exec(cmd.c_str());
+
+	for (Reader& reader : readers)
+	{
+		while (ReadPipe(reader)) {}
+		pclose(reader.pipe);
+	}
+
+	readers.clear();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::ReadPipe(Reader& reader)
+{
+	ssize_t count = read(fileno(reader.pipe), &reader.page[reader.pageSize], reader.page.size() - reader.pageSize);
+	if (count <= 0)
+		return false;
+
+	reader.pageSize += (size_t)count;
+
+	// Pipe doesn't preserve page boundaries
+	if (reader.pageSize == reader.page.size())
+	{
+		ParsePage(reader);
+		reader.pageSize = 0;
+	}
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FTrace::ReaderThread()
+{
+	vector<pollfd> fds;
+	for (const Reader& reader : readers)
+	{
+		pollfd fd = { fileno(reader.pipe), POLLIN, 0 };
+		fds.push_back(fd);
+	}
+
+	for (;;)
+	{
+		if (hasPendingSysCallThreads)
+			UpdateSysCallFilter();
+
+		int count = poll(fds.data(), (nfds_t)fds.size(), FTRACE_POLL_TIMEOUT_MS);
+
+		if (count > 0)
+		{
+			for (size_t i = 0; i < fds.size(); ++i)
+			{
+				if (fds[i].revents & POLLIN)
+					ReadPipe(readers[i]);
+				else if (fds[i].revents & (POLLHUP | POLLERR))
+					fds[i].fd = -1;
+			}
+		}
+		else if (!isReading)
+		{
+			// Tracing is disabled and all the pending data is processed
+			break;
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FTrace::ParsePage(const Reader& reader)
+{
+	const uint8_t* page = reader.page.data();
+	int64 timestamp = headerPage.timestamp.read_int(page);
+	size_t commit = (size_t)(headerPage.commit.read_int(page) & ft::ring_buffer_event::COMMIT_MASK);
+
+	const uint8_t* cursor = page + headerPage.data.offset;
+	const uint8_t* finish = std::min(cursor + commit, page + reader.page.size());
+
+	while (cursor + sizeof(uint32_t) <= finish)
+	{
+		uint32_t header;
+		memcpy(&header, cursor, sizeof(header));
+		cursor += sizeof(header);
+
+		uint32_t typeLength = header & ((1 << 5) - 1);
+		uint32_t timeDelta = header >> 5;
+
+		uint32_t array0 = 0;
+		if (typeLength == 0 || typeLength > ft::ring_buffer_event::TYPE_DATA_MAX)
+		{
+			if (cursor + sizeof(array0) > finish)
+				break;
+			memcpy(&array0, cursor, sizeof(array0));
+		}
+
+		switch (typeLength)
+		{
+		case ft::ring_buffer_event::TYPE_PADDING:
+			// Discarded event or the end of the page
+			if (timeDelta == 0)
+				return;
+			cursor += array0;
+			break;
+
+		case ft::ring_buffer_event::TYPE_TIME_EXTEND:
+			timestamp += ((uint64_t)array0 << ft::ring_buffer_event::TIME_SHIFT) + timeDelta;
+			cursor += sizeof(array0);
+			break;
+
+		case ft::ring_buffer_event::TYPE_TIME_STAMP:
+			timestamp = (int64)(((uint64_t)array0 << ft::ring_buffer_event::TIME_SHIFT) + timeDelta);
+			cursor += sizeof(array0);
+			break;
+
+		case 0:
+		{
+			// Big event: length is stored in the first word of the payload
+			timestamp += timeDelta;
+			size_t size = array0 > sizeof(array0) ? array0 - sizeof(array0) : 0;
+			cursor += sizeof(array0);
+			if (cursor + size > finish)
+				return;
+			ParseEvent(reader.cpu, timestamp, cursor, size);
+			cursor += (size + 3) & ~(size_t)3;
+			break;
+		}
+
+		default:
+		{
+			timestamp += timeDelta;
+			size_t size = typeLength * sizeof(uint32_t);
+			if (cursor + size > finish)
+				return;
+			ParseEvent(reader.cpu, timestamp, cursor, size);
+			cursor += size;
+			break;
+		}
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void KernelTrace::ParseEvent(int cpu, int64 timestamp, const uint8_t* data, size_t size)
+{
+	if (sysEnterFormat.match(data, size) || sysExitFormat.match(data, size))
+	{
+		bool isExit = sysExitFormat.match(data, size);
+		const ft::raw_syscall_format& format = isExit ? sysExitFormat : sysEnterFormat;
+
+		pid_t threadID = (pid_t)format.common_pid.read_int(data);
+		if (!syscallThreads.empty() && syscallThreads.find(threadID) == syscallThreads.end())
+			return;
+
+		SysCallEvent ev;
+		ev.timestamp = timestamp;
+		ev.threadID = (uint32)threadID;
+		ev.id = (int32)format.syscall_id.read_int(data);
+		ev.isExit = isExit;
+		syscallEvents.push_back(ev);
+		return;
+	}
+
+	if (wakeupFormat.match(data, size))
+	{
+		WakeupDesc desc;
+		desc.timestamp = timestamp;
+		desc.wakerThreadId = (uint64)wakeupFormat.common_pid.read_int(data);
+		desc.wakeeThreadId = (uint64)wakeupFormat.pid.read_int(data);
+		desc.cpuId = (uint8)wakeupFormat.target_cpu.read_int(data);
+		Core::Get().ReportWakeup(desc);
+		return;
+	}
+
+	if (size < switchFormat.next_prio.offset + switchFormat.next_prio.size)
+		return;
+
+	if (switchFormat.common_type.read_int(data) != switchFormat.id)
+		return;
+
+	ft::sched_switch ev;
+	ev.cpu_id = (uint8_t)cpu;
+	ev.timestamp = timestamp;
+	switchFormat.prev_comm.read_string(data, ev.prev_comm, OPTICK_ARRAY_SIZE(ev.prev_comm));
+	ev.prev_pid = (pid_t)switchFormat.prev_pid.read_int(data);
+	ev.prev_prio = (int)switchFormat.prev_prio.read_int(data);
+	ev.prev_state = switchFormat.decode_state(switchFormat.prev_state.read_int(data));
+	switchFormat.next_comm.read_string(data, ev.next_comm, OPTICK_ARRAY_SIZE(ev.next_comm));
+	ev.next_pid = (pid_t)switchFormat.next_pid.read_int(data);
+	ev.next_prio = (int)switchFormat.next_prio.read_int(data);
+
+	ProcessEvent(ev);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void KernelTrace::FlushSysCalls()
+{
+	std::sort(syscallEvents.begin(), syscallEvents.end(), [](const SysCallEvent& a, const SysCallEvent& b)
+	{
+		if (a.threadID != b.threadID)
+			return a.threadID < b.threadID;
+		if (a.timestamp != b.timestamp)
+			return a.timestamp < b.timestamp;
+		return !a.isExit && b.isExit;
+	});
+
+	// Unpaired records (exit_group, execve or calls which were active at the start\end of the capture) are skipped
+	for (size_t i = 0; i + 1 < syscallEvents.size(); ++i)
+	{
+		const SysCallEvent& enter = syscallEvents[i];
+		const SysCallEvent& exit = syscallEvents[i + 1];
+
+		if (!enter.isExit && exit.isExit && enter.threadID == exit.threadID && enter.id == exit.id)
+		{
+			SysCallData& sysCall = Core::Get().syscallCollector.Add();
+			sysCall.start = enter.timestamp;
+			sysCall.finish = exit.timestamp;
+			sysCall.threadID = enter.threadID;
+			sysCall.id = (uint64)enter.id;
+			sysCall.description = nullptr;
+			++i;
+		}
+	}
+
+	vector<SysCallEvent>().swap(syscallEvents);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool KernelTrace::ProcessEvent(const ft::base_event& ev)
+{
+	switch (ev.common_type)
+	{
+	case ft::sched_switch::type:
+	{
+		const ft::sched_switch& switchEv = (const ft::sched_switch&)ev;
+		SwitchContextDesc desc;
+		desc.reason = switchEv.prev_state + PROCESS_STATE_REASON_START;
+		desc.cpuId = switchEv.cpu_id;
+		desc.oldThreadId = (uint64)switchEv.prev_pid;
+		desc.newThreadId = (uint64)switchEv.next_pid;
+		desc.timestamp = switchEv.timestamp;
+		Core::Get().ReportSwitchContext(desc);
+
+		if (pidCache.find(switchEv.next_pid) == pidCache.end())
+		{
+			pidCache.insert(switchEv.next_pid);
+			if (processScanner.IsActive())
+				processScanner.Register(switchEv.next_pid, switchEv.next_comm, switchEv.next_prio);
+			else
+				Core::Get().RegisterThreadDescription(ThreadDescription(switchEv.next_comm, (ThreadID)switchEv.next_pid, (ProcessID)switchEv.next_pid, 1, switchEv.next_prio));
+		}
+
+		return true;
+	}
+	break;
+	}
+
+	return false;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::Set(const char * name, bool value)
+{
+	return Set(name, value ? "1" : "0");
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::Set(const char* name, const char* value)
+{
+	// Values might be long (e.g. event filters)
+	string command = string("echo ") + value + " > " + KERNEL_TRACING_PATH + "/" + name;
+	return Exec(command.c_str());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::Read(const char* name, string& output)
+{
+	string cmd = string("cat ") + KERNEL_TRACING_PATH + "/" + name;
+
+	output.clear();
+
+	if (FILE* pipe = Open(cmd.c_str()))
+	{
+		char buffer[1024];
+		while (size_t count = fread(buffer, 1, sizeof(buffer), pipe))
+			output.append(buffer, count);
+		pclose(pipe);
+	}
+
+	return !output.empty();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FTrace::Exec(const char* cmd)
+{
+	string command = string("echo \'") + password + "\' | sudo -S sh -c \'" + cmd + "\' 2> /dev/null";
+	return std::system(command.c_str()) == 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FILE* FTrace::Open(const char* cmd)
+{
+	// Silencing the shell as well (it reports the termination of the readers)
+	string command = string("exec 2> /dev/null; echo \'") + password + "\' | sudo -S sh -c \'" + cmd + "\'";
+	return popen(command.c_str(), "r");
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FTrace::FTrace() : isActive(false), wakeupEvent(nullptr), hasPendingSysCallThreads(false), isSysCallsActive(false), isReading(false)
+{
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FTrace::~FTrace()
+{
+	Stop();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfReader::Open(perf_event_attr& attr, pid_t pid, int cpu, size_t pageCount)
+{
+	Buffer buffer;
+	buffer.cpu = cpu;
+	buffer.fd = (int)syscall(SYS_perf_event_open, &attr, pid, cpu, -1, PERF_FLAG_FD_CLOEXEC);
+
+	if (buffer.fd < 0)
+		return false;
+
+	// First page is the header followed by 2^n data pages
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	void* memory = mmap(nullptr, (pageCount + 1) * pageSize, PROT_READ | PROT_WRITE, MAP_SHARED, buffer.fd, 0);
+	if (memory == MAP_FAILED)
+	{
+		close(buffer.fd);
+		return false;
+	}
+
+	buffer.header = (perf_event_mmap_page*)memory;
+	buffer.data = (uint8_t*)memory + pageSize;
+	buffer.size = pageCount * pageSize;
+
+	if (isReading)
+	{
+		ioctl(buffer.fd, PERF_EVENT_IOC_ENABLE, 0);
+
+		std::lock_guard<std::mutex> lock(pendingLock);
+		pendingBuffers.push_back(buffer);
+	}
+	else
+	{
+		buffers.push_back(buffer);
+	}
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfReader::Start()
+{
+	if (buffers.empty())
+		return false;
+
+	for (Buffer& buffer : buffers)
+		ioctl(buffer.fd, PERF_EVENT_IOC_ENABLE, 0);
+
+	isReading = true;
+	readerThread = std::thread(&PerfReader::ReaderThread, this);
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfReader::Stop()
+{
+	if (buffers.empty())
+		return;
+
+	for (Buffer& buffer : buffers)
+		ioctl(buffer.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+	isReading = false;
+	if (readerThread.joinable())
+		readerThread.join();
+
+	AddPending();
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	for (Buffer& buffer : buffers)
+	{
+		ioctl(buffer.fd, PERF_EVENT_IOC_DISABLE, 0);
+		Read(buffer);
+		munmap(buffer.header, buffer.size + pageSize);
+		close(buffer.fd);
+	}
+
+	buffers.clear();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfReader::Read(Buffer& buffer)
+{
+	uint64_t head = __atomic_load_n(&buffer.header->data_head, __ATOMIC_ACQUIRE);
+	uint64_t tail = buffer.header->data_tail;
+
+	if (head == tail)
+		return false;
+
+	while (tail < head)
+	{
+		size_t offset = (size_t)(tail % buffer.size);
+
+		perf_event_header record;
+		if (offset + sizeof(record) <= buffer.size)
+		{
+			memcpy(&record, buffer.data + offset, sizeof(record));
+		}
+		else
+		{
+			size_t part = buffer.size - offset;
+			memcpy(&record, buffer.data + offset, part);
+			memcpy((uint8_t*)&record + part, buffer.data, sizeof(record) - part);
+		}
+
+		if (record.size == 0)
+			break;
+
+		if (record.type == PERF_RECORD_SAMPLE)
+		{
+			const uint8_t* data = buffer.data + offset;
+
+			// Record wraps around the end of the buffer
+			if (offset + record.size > buffer.size)
+			{
+				scratch.resize(record.size);
+				size_t part = buffer.size - offset;
+				memcpy(scratch.data(), buffer.data + offset, part);
+				memcpy(scratch.data() + part, buffer.data, record.size - part);
+				data = scratch.data();
+			}
+
+			sampleCb(sampleContext, buffer, data, record.size);
+		}
+
+		tail += record.size;
+	}
+
+	__atomic_store_n(&buffer.header->data_tail, tail, __ATOMIC_RELEASE);
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfReader::AddPending()
+{
+	std::lock_guard<std::mutex> lock(pendingLock);
+
+	if (pendingBuffers.empty())
+		return false;
+
+	buffers.insert(buffers.end(), pendingBuffers.begin(), pendingBuffers.end());
+	pendingBuffers.clear();
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfReader::ReaderThread()
+{
+	vector<pollfd> fds;
+
+	while (isReading)
+	{
+		if (AddPending() || fds.empty())
+		{
+			fds.clear();
+			for (const Buffer& buffer : buffers)
+			{
+				pollfd fd = { buffer.fd, POLLIN, 0 };
+				fds.push_back(fd);
+			}
+		}
+
+		poll(fds.data(), (nfds_t)fds.size(), FTRACE_POLL_TIMEOUT_MS);
+
+		for (Buffer& buffer : buffers)
+			Read(buffer);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureStatus::Type PerfSampler::Start(int frequency, const ThreadList& threads)
+{
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_SOFTWARE;
+	attr.config = PERF_COUNT_SW_CPU_CLOCK;
+	attr.freq = 1;
+	attr.sample_freq = (uint64_t)std::max(frequency, 1);
+	attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_CALLCHAIN;
+	attr.disabled = 1;
+	// User-space stacks only (doesn't require privileges)
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.exclude_callchain_kernel = 1;
+	// Same clock as Platform::GetTime
+	attr.use_clockid = 1;
+	attr.clockid = CLOCK_MONOTONIC;
+	attr.watermark = 1;
+	attr.wakeup_watermark = (uint32_t)(PERF_SAMPLER_PAGE_COUNT * sysconf(_SC_PAGESIZE) / 4);
+
+	bool isAccessDenied = false;
+
+	for (const ThreadEntry* entry : threads)
+	{
+		if (!entry->isAlive)
+			continue;
+
+		if (!reader.Open(attr, (pid_t)entry->description.threadID, -1, PERF_SAMPLER_PAGE_COUNT))
+			isAccessDenied |= (errno == EACCES || errno == EPERM);
+	}
+
+	if (!reader.Start())
+		return isAccessDenied ? CaptureStatus::ERR_TRACER_ACCESS_DENIED : CaptureStatus::ERR_TRACER_FAILED;
+
+	isActive = true;
+	return CaptureStatus::OK;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfSampler::AddThread(const ThreadEntry* entry)
+{
+	if (isActive)
+		reader.Open(attr, (pid_t)entry->description.threadID, -1, PERF_SAMPLER_PAGE_COUNT);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfSampler::Stop()
+{
+	isActive = false;
+	reader.Stop();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfSampler::OnSample(void* /*context*/, const PerfReader::Buffer& /*buffer*/, const uint8_t* record, size_t size)
+{
+	// PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_CALLCHAIN
+	struct Sample
+	{
+		perf_event_header header;
+		uint32_t pid;
+		uint32_t tid;
+		uint64_t time;
+		uint64_t count;
+	};
+
+	if (size < sizeof(Sample))
+		return;
+
+	Sample sample;
+	memcpy(&sample, record, sizeof(sample));
+
+	if (sizeof(Sample) + sample.count * sizeof(uint64) > size)
+		return;
+
+	uint64 callstack[PERF_SAMPLER_MAX_DEPTH];
+	uint8 count = 0;
+
+	const uint8_t* ip = record + sizeof(Sample);
+	for (uint64_t i = 0; i < sample.count && count < PERF_SAMPLER_MAX_DEPTH; ++i, ip += sizeof(uint64))
+	{
+		uint64 address;
+		memcpy(&address, ip, sizeof(address));
+
+		// Skipping PERF_CONTEXT_USER\KERNEL markers
+		if (address >= (uint64)PERF_CONTEXT_MAX)
+			continue;
+
+		callstack[count++] = address;
+	}
+
+	if (count == 0)
+		return;
+
+	CallstackDesc desc;
+	desc.threadID = sample.tid;
+	desc.timestamp = sample.time;
+	desc.callstack = callstack;
+	desc.count = count;
+	Core::Get().ReportStackWalk(desc);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+PerfTrace::PerfTrace() : isActive(false), isSysCallsActive(false), reader(&PerfTrace::OnSample, this)
+{
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+PerfTrace::~PerfTrace()
+{
+	Stop();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfTrace::ReadFormat(const char* name, string& output)
+{
+	output.clear();
+
+	for (const char* path : PERF_TRACING_PATHS)
+	{
+		char fullPath[256] = { 0 };
+		sprintf_s(fullPath, "%s/%s", path, name);
+
+		if (FILE* file = fopen(fullPath, "r"))
+		{
+			char buffer[1024];
+			while (size_t count = fread(buffer, 1, sizeof(buffer), file))
+				output.append(buffer, count);
+			fclose(file);
+
+			if (!output.empty())
+				return true;
+		}
+	}
+	return false;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int PerfTrace::GetTracepointID()
+{
+	string format;
+	ft::sched_switch_format switchFormat;
+	return (ReadFormat(PERF_SCHED_SWITCH_FORMAT, format) && switchFormat.parse(format.c_str())) ? switchFormat.id : -1;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfTrace::InitAttributes(perf_event_attr& attr, int tracepoint)
+{
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_TRACEPOINT;
+	attr.config = (uint64_t)tracepoint;
+	attr.sample_period = 1;
+	attr.sample_type = PERF_SAMPLE_TIME | PERF_SAMPLE_CPU | PERF_SAMPLE_RAW;
+	attr.disabled = 1;
+	// Same clock as Platform::GetTime
+	attr.use_clockid = 1;
+	attr.clockid = CLOCK_MONOTONIC;
+	attr.watermark = 1;
+	attr.wakeup_watermark = (uint32_t)(PERF_BUFFER_PAGE_COUNT * sysconf(_SC_PAGESIZE) / 4);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int PerfTrace::OpenEvent(int tracepoint, int cpu)
+{
+	perf_event_attr attr;
+	InitAttributes(attr, tracepoint);
+	return (int)syscall(SYS_perf_event_open, &attr, -1, cpu, -1, PERF_FLAG_FD_CLOEXEC);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfTrace::IsAvailable()
+{
+	// System-wide tracepoints require either privileges or perf_event_paranoid == -1
+	if (geteuid() != 0)
+	{
+		FILE* file = fopen(PERF_EVENT_PARANOID, "r");
+		if (file == nullptr)
+			return false;
+
+		int paranoid = 2;
+		bool isParsed = fscanf(file, "%d", &paranoid) == 1;
+		fclose(file);
+
+		if (!isParsed || paranoid > -1)
+			return false;
+	}
+
+	int tracepoint = GetTracepointID();
+	if (tracepoint < 0)
+		return false;
+
+	// Containers might still forbid perf_event_open with seccomp
+	int fd = OpenEvent(tracepoint, 0);
+	if (fd < 0)
+		return false;
+
+	close(fd);
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureStatus::Type PerfTrace::Start(Mode::Type mode, int frequency, const ThreadList& threads)
+{
+	if (!isActive)
+	{
+		if (mode & Mode::AUTOSAMPLING)
+		{
+			CaptureStatus::Type status = StartSampling(frequency, threads);
+			if (status != CaptureStatus::OK)
+				return status;
+		}
+
+		if (mode & Mode::SWITCH_CONTEXT)
+		{
+			string format;
+			if (!ReadFormat(PERF_SCHED_SWITCH_FORMAT, format) || !switchFormat.parse(format.c_str()))
+			{
+				StopSampling();
+				return CaptureStatus::ERR_TRACER_FAILED;
+			}
+
+			perf_event_attr attr;
+			InitAttributes(attr, switchFormat.id);
+
+			long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+			for (int cpu = 0; cpu < cpuCount; ++cpu)
+				reader.Open(attr, -1, cpu, PERF_BUFFER_PAGE_COUNT);
+
+			if (reader.IsEmpty())
+			{
+				StopSampling();
+				return CaptureStatus::ERR_TRACER_ACCESS_DENIED;
+			}
+
+			if (mode & Mode::OTHER_PROCESSES)
+				processScanner.Start();
+
+			// Wake up events are optional
+			if ((ReadFormat(PERF_SCHED_WAKING_FORMAT, format) && wakeupFormat.parse(format.c_str())) ||
+				(ReadFormat(PERF_SCHED_WAKEUP_FORMAT, format) && wakeupFormat.parse(format.c_str())))
+			{
+				InitAttributes(attr, wakeupFormat.id);
+				for (int cpu = 0; cpu < cpuCount; ++cpu)
+					reader.Open(attr, -1, cpu, PERF_BUFFER_PAGE_COUNT);
+			}
+		}
+
+		// System calls are optional (raw_syscalls might be missing in the kernel config)
+		if (mode & Mode::SYS_CALLS)
+			isSysCallsActive = StartSysCalls(threads);
+
+		if (!reader.IsEmpty())
+			reader.Start();
+
+		isActive = true;
+	}
+
+	return CaptureStatus::OK;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfTrace::Stop()
+{
+	if (!isActive)
+	{
+		return false;
+	}
+
+	StopSampling();
+
+	isSysCallsActive = false;
+	reader.Stop();
+
+	FlushSysCalls();
+
+	pidCache.clear();
+	processScanner.Stop();
+
+	isActive = false;
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfTrace::AddThread(const ThreadEntry* entry)
+{
+	KernelTrace::AddThread(entry);
+
+	if (isSysCallsActive)
+		OpenSysCalls((pid_t)entry->description.threadID);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PerfTrace::StartSysCalls(const ThreadList& threads)
+{
+	string format;
+	if (!ReadFormat(PERF_SYS_ENTER_FORMAT, format) || !sysEnterFormat.parse(format.c_str()))
+		return false;
+
+	if (!ReadFormat(PERF_SYS_EXIT_FORMAT, format) || !sysExitFormat.parse(format.c_str()))
+		return false;
+
+	// Per-thread events: the kernel filters out the rest of the system
+	for (const ThreadEntry* entry : threads)
+		if (entry->isAlive)
+			OpenSysCalls((pid_t)entry->description.threadID);
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfTrace::OpenSysCalls(pid_t threadID)
+{
+	perf_event_attr attr;
+
+	InitAttributes(attr, sysEnterFormat.id);
+	attr.wakeup_watermark = (uint32_t)(PERF_SYSCALL_PAGE_COUNT * sysconf(_SC_PAGESIZE) / 4);
+	reader.Open(attr, threadID, -1, PERF_SYSCALL_PAGE_COUNT);
+
+	InitAttributes(attr, sysExitFormat.id);
+	attr.wakeup_watermark = (uint32_t)(PERF_SYSCALL_PAGE_COUNT * sysconf(_SC_PAGESIZE) / 4);
+	reader.Open(attr, threadID, -1, PERF_SYSCALL_PAGE_COUNT);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PerfTrace::OnSample(void* context, const PerfReader::Buffer& buffer, const uint8_t* record, size_t size)
+{
+	// PERF_SAMPLE_TIME | PERF_SAMPLE_CPU | PERF_SAMPLE_RAW
+	struct Sample
+	{
+		perf_event_header header;
+		uint64_t time;
+		uint32_t cpu;
+		uint32_t reserved;
+	};
+
+	uint32_t rawSize = 0;
+	if (size < sizeof(Sample) + sizeof(rawSize))
+		return;
+
+	Sample sample;
+	memcpy(&sample, record, sizeof(sample));
+	memcpy(&rawSize, record + sizeof(Sample), sizeof(rawSize));
+
+	const uint8_t* raw = record + sizeof(Sample) + sizeof(rawSize);
+	if (raw + rawSize > record + size)
+		return;
+
+	static_cast<PerfTrace*>(context)->ParseEvent(buffer.cpu, (int64)sample.time, raw, rawSize);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Trace* Platform::CreateTrace()
+{
+	if (PerfTrace::IsAvailable())
+		return Memory::New<PerfTrace>();
+
+	return Memory::New<FTrace>();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbol engine
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const char* PROC_SELF_MAPS = "/proc/self/maps";
+static const char* DEBUG_BUILD_ID_PATH = "/usr/lib/debug/.build-id";
+static const char* SYMBOL_CACHE_ENV = "OPTICK_SYMBOL_CACHE";
+static const uint32 SYMBOL_CACHE_MAGIC = 0x4F505343; // OPSC
+static const uint32 SYMBOL_CACHE_VERSION = 2;
+static const size_t SYMBOL_CACHE_MAX_ENTRIES = 1 << 16; // Per module
+static const uint32 SYMBOL_CACHE_MAX_STRING = 64 << 10;
+static const uint64 SYMBOL_CACHE_MAX_DIRECTORY_SIZE = 256ull << 20; // 256Mb
+static const uint32 SYMBOL_ENGINE_MAX_THREAD_COUNT = 8;
+static const size_t SYMBOL_ENGINE_BATCH_SIZE = 256;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static wstring ToWideString(const char* text)
+{
+	// UTF-8 => UTF-32
+	wstring result;
+	for (const unsigned char* p = (const unsigned char*)text; *p;)
+	{
+		uint32 code = *p++;
+		int extra = code >= 0xF0 ? 3 : code >= 0xE0 ? 2 : code >= 0xC0 ? 1 : 0;
+		code &= extra ? (0x3F >> extra) : 0x7F;
+		for (; extra > 0 && (*p & 0xC0) == 0x80; --extra)
+			code = (code << 6) | (*p++ & 0x3F);
+		result.push_back((wchar_t)code);
+	}
+	return result;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Read-only mapping of an ELF image
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ElfFile
+{
+	const uint8_t* data;
+	size_t size;
+	vector<vector<uint8_t>> decompressed;
+public:
+	struct Section
+	{
+		const uint8_t* data;
+		size_t size;
+		Section() : data(nullptr), size(0) {}
+	};
+
+	ElfFile() : data(nullptr), size(0) {}
+	~ElfFile() { Close(); }
+
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const { return data != nullptr; }
+
+	const ElfW(Ehdr)* GetHeader() const { return (const ElfW(Ehdr)*)data; }
+	const ElfW(Shdr)* GetSectionHeader(uint32 index) const;
+	const ElfW(Shdr)* FindSectionHeader(const char* name) const;
+	bool GetSection(const ElfW(Shdr)* header, Section& section);
+	bool GetSection(const char* name, Section& section) { return GetSection(FindSectionHeader(name), section); }
+
+	string GetBuildID() const;
+	// Virtual address of the file offset 0 (runtime address = bias + virtual address)
+	uint64 GetImageBase() const;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ElfFile::Open(const char* path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(ElfW(Ehdr)))
+	{
+		void* memory = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (memory != MAP_FAILED)
+		{
+			data = (const uint8_t*)memory;
+			size = (size_t)info.st_size;
+		}
+	}
+	close(fd);
+
+	if (data == nullptr)
+		return false;
+
+	// Only native ELF images can be mapped into the process
+	const ElfW(Ehdr)* header = GetHeader();
+	if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32) ||
+		header->e_shoff + (uint64)header->e_shnum * sizeof(ElfW(Shdr)) > size || header->e_phoff + (uint64)header->e_phnum * sizeof(ElfW(Phdr)) > size)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ElfFile::Close()
+{
+	if (data)
+	{
+		munmap((void*)data, size);
+		data = nullptr;
+		size = 0;
+	}
+	decompressed.clear();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const ElfW(Shdr)* ElfFile::GetSectionHeader(uint32 index) const
+{
+	const ElfW(Ehdr)* header = GetHeader();
+	if (index >= header->e_shnum)
+		return nullptr;
+	return (const ElfW(Shdr)*)(data + header->e_shoff) + index;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const ElfW(Shdr)* ElfFile::FindSectionHeader(const char* name) const
+{
+	const ElfW(Shdr)* names = GetSectionHeader(GetHeader()->e_shstrndx);
+	if (names == nullptr || names->sh_offset + names->sh_size > size)
+		return nullptr;
+
+	for (uint32 i = 0; i < GetHeader()->e_shnum; ++i)
+	{
+		const ElfW(Shdr)* section = GetSectionHeader(i);
+		if (section->sh_name < names->sh_size && strncmp((const char*)data + names->sh_offset + section->sh_name, name, names->sh_size - section->sh_name) == 0)
+			return section;
+	}
+	return nullptr;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ElfFile::GetSection(const ElfW(Shdr)* header, Section& section)
+{
+	if (header == nullptr || header->sh_type == SHT_NOBITS || header->sh_offset + header->sh_size > size)
+		return false;
+
+	section.data = data + header->sh_offset;
+	section.size = header->sh_size;
+
+	// Debug sections are often compressed with zlib (--compress-debug-sections)
+	if (header->sh_flags & SHF_COMPRESSED)
+	{
+#if OPTICK_ENABLE_COMPRESSION
+		ElfW(Chdr) compression;
+		if (section.size < sizeof(compression))
+			return false;
+
+		memcpy(&compression, section.data, sizeof(compression));
+		if (compression.ch_type != ELFCOMPRESS_ZLIB)
+			return false;
+
+		decompressed.push_back(vector<uint8_t>());
+		vector<uint8_t>& output = decompressed.back();
+		output.resize(compression.ch_size);
+
+		size_t length = tinfl_decompress_mem_to_mem(output.data(), output.size(), section.data + sizeof(compression), section.size - sizeof(compression), TINFL_FLAG_PARSE_ZLIB_HEADER);
+		if (length != output.size())
+			return false;
+
+		section.data = output.data();
+		section.size = output.size();
+#else
+		return false;
+#endif
+	}
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+string ElfFile::GetBuildID() const
+{
+	const ElfW(Shdr)* header = FindSectionHeader(".note.gnu.build-id");
+	if (header == nullptr || header->sh_offset + header->sh_size > size || header->sh_size < sizeof(ElfW(Nhdr)))
+		return string();
+
+	const uint8_t* note = data + header->sh_offset;
+	ElfW(Nhdr) nhdr;
+	memcpy(&nhdr, note, sizeof(nhdr));
+
+	size_t descOffset = sizeof(nhdr) + ((nhdr.n_namesz + 3) & ~3);
+	if (nhdr.n_type != NT_GNU_BUILD_ID || descOffset + nhdr.n_descsz > header->sh_size)
+		return string();
+
+	static const char* HEX = "0123456789abcdef";
+	string result;
+	for (uint32 i = 0; i < nhdr.n_descsz; ++i)
+	{
+		uint8_t byte = note[descOffset + i];
+		result.push_back(HEX[byte >> 4]);
+		result.push_back(HEX[byte & 0xF]);
+	}
+	return result;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64 ElfFile::GetImageBase() const
+{
+	const ElfW(Ehdr)* header = GetHeader();
+	for (uint32 i = 0; i < header->e_phnum; ++i)
+	{
+		const ElfW(Phdr)* segment = (const ElfW(Phdr)*)(data + header->e_phoff) + i;
+		if (segment->p_type == PT_LOAD)
+			return segment->p_vaddr - segment->p_offset;
+	}
+	return 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// DWARF line number program (.debug_line, versions 2-5)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class DwarfLineTable
+{
+public:
+	struct Row
+	{
+		uint64 address;
+		uint32 file;
+		uint32 line; // 0 - end of sequence
+		bool operator<(const Row& other) const { return address < other.address; }
+	};
+
+	vector<Row> rows;
+	vector<string> files;
+
+	void Parse(const ElfFile::Section& debugLine, const ElfFile::Section& debugLineStr, const ElfFile::Section& debugStr);
+	const Row* Find(uint64 address) const;
+private:
+	struct Reader
+	{
+		const uint8_t* cursor;
+		const uint8_t* finish;
+		bool isFailed;
+
+		Reader(const uint8_t* b, const uint8_t* e) : cursor(b), finish(e), isFailed(false) {}
+
+		bool Has(size_t count) { if ((size_t)(finish - cursor) < count) isFailed = true; return !isFailed; }
+		uint64 Read(size_t count) { uint64 val = 0; if (Has(count)) { memcpy(&val, cursor, count); cursor += count; } return val; }
+		uint8_t U8() { return (uint8_t)Read(1); }
+		uint16_t U16() { return (uint16_t)Read(2); }
+		uint32_t U32() { return (uint32_t)Read(4); }
+		uint64 ULEB() { uint64 val = 0; for (int shift = 0; Has(1); shift += 7) { uint8_t b = *cursor++; if (shift < 64) val |= (uint64)(b & 0x7F) << shift; if (!(b & 0x80)) break; } return val; }
+		int64 SLEB() { int64 val = 0; int shift = 0; uint8_t b = 0; while (Has(1)) { b = *cursor++; if (shift < 64) val |= (int64)(b & 0x7F) << shift; shift += 7; if (!(b & 0x80)) break; } if (shift < 64 && (b & 0x40)) val |= -((int64)1 << shift); return val; }
+		const char* String() { const char* s = (const char*)cursor; while (Has(1) && *cursor++) {} return isFailed ? "" : s; }
+		void Skip(uint64 count) { if (Has(count)) cursor += count; }
+	};
+
+	static const char* GetString(const ElfFile::Section& section, uint64 offset) { return offset < section.size ? (const char*)section.data + offset : ""; }
+	static bool ReadEntry(Reader& reader, const vector<std::pair<uint64, uint64>>& format, size_t offsetSize, const ElfFile::Section& debugLineStr, const ElfFile::Section& debugStr, const char*& path, uint64& directory);
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool DwarfLineTable::ReadEntry(Reader& reader, const vector<std::pair<uint64, uint64>>& format, size_t offsetSize, const ElfFile::Section& debugLineStr, const ElfFile::Section& debugStr, const char*& path, uint64& directory)
+{
+	enum { DW_LNCT_path = 1, DW_LNCT_directory_index = 2 };
+	enum { DW_FORM_block = 0x09, DW_FORM_data1 = 0x0b, DW_FORM_data2 = 0x05, DW_FORM_data4 = 0x06, DW_FORM_data8 = 0x07, DW_FORM_data16 = 0x1e, DW_FORM_string = 0x08, DW_FORM_strp = 0x0e, DW_FORM_line_strp = 0x1f, DW_FORM_udata = 0x0f, DW_FORM_sdata = 0x0d };
+
+	for (const std::pair<uint64, uint64>& field : format)
+	{
+		uint64 value = 0;
+		const char* text = nullptr;
+
+		switch (field.second)
+		{
+		case DW_FORM_string: text = reader.String(); break;
+		case DW_FORM_strp: text = GetString(debugStr, reader.Read(offsetSize)); break;
+		case DW_FORM_line_strp: text = GetString(debugLineStr, reader.Read(offsetSize)); break;
+		case DW_FORM_udata: value = reader.ULEB(); break;
+		case DW_FORM_sdata: value = (uint64)reader.SLEB(); break;
+		case DW_FORM_data1: value = reader.U8(); break;
+		case DW_FORM_data2: value = reader.U16(); break;
+		case DW_FORM_data4: value = reader.U32(); break;
+		case DW_FORM_data8: value = reader.Read(8); break;
+		case DW_FORM_data16: reader.Skip(16); break;
+		case DW_FORM_block: reader.Skip(reader.ULEB()); break;
+		default: return false; // Unsupported form (e.g. strx requires .debug_info)
+		}
+
+		if (field.first == DW_LNCT_path && text)
+			path = text;
+		else if (field.first == DW_LNCT_directory_index)
+			directory = value;
+	}
+	return !reader.isFailed;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void DwarfLineTable::Parse(const ElfFile::Section& debugLine, const ElfFile::Section& debugLineStr, const ElfFile::Section& debugStr)
+{
+	enum { DW_LNS_copy = 1, DW_LNS_advance_pc, DW_LNS_advance_line, DW_LNS_set_file, DW_LNS_set_column, DW_LNS_negate_stmt, DW_LNS_set_basic_block, DW_LNS_const_add_pc, DW_LNS_fixed_advance_pc };
+	enum { DW_LNE_end_sequence = 1, DW_LNE_set_address, DW_LNE_define_file };
+
+	Reader unit(debugLine.data, debugLine.data + debugLine.size);
+
+	while (unit.cursor < unit.finish && !unit.isFailed)
+	{
+		size_t offsetSize = 4;
+		uint64 length = unit.U32();
+		if (length == 0xFFFFFFFF)
+		{
+			offsetSize = 8;
+			length = unit.Read(8);
+		}
+
+		if (!unit.Has(length))
+			break;
+
+		Reader reader(unit.cursor, unit.cursor + length);
+		unit.cursor += length;
+
+		uint16_t version = reader.U16();
+		if (version < 2 || version > 5)
+			continue;
+
+		if (version >= 5)
+		{
+			reader.U8(); // address_size
+			reader.U8(); // segment_selector_size
+		}
+
+		uint64 headerLength = reader.Read(offsetSize);
+		const uint8_t* program = reader.cursor + headerLength;
+
+		uint8_t minInstructionLength = reader.U8();
+		if (version >= 4)
+			reader.U8(); // maximum_operations_per_instruction
+		reader.U8(); // default_is_stmt
+		int8_t lineBase = (int8_t)reader.U8();
+		uint8_t lineRange = reader.U8();
+		uint8_t opcodeBase = reader.U8();
+
+		if (lineRange == 0 || opcodeBase == 0)
+			continue;
+
+		uint8_t opcodeLengths[256] = { 0 };
+		for (uint32 i = 1; i < opcodeBase; ++i)
+			opcodeLengths[i] = reader.U8();
+
+		// Unit file table => global file indices
+		vector<const char*> directories;
+		vector<uint32> fileIndices;
+
+		auto AddFile = [&](const char* path, uint64 directory)
+		{
+			string fullPath;
+			if (path[0] != '/' && directory < directories.size() && directories[directory][0] != '\0')
+			{
+				fullPath = directories[directory];
+				fullPath += '/';
+			}
+			fullPath += path;
+			fileIndices.push_back((uint32)files.size());
+			files.push_back(fullPath);
+		};
+
+		if (version >= 5)
+		{
+			vector<std::pair<uint64, uint64>> format;
+
+			for (int table = 0; table < 2 && !reader.isFailed; ++table)
+			{
+				format.clear();
+				uint8_t formatCount = reader.U8();
+				for (uint8_t i = 0; i < formatCount; ++i)
+				{
+					uint64 type = reader.ULEB();
+					uint64 form = reader.ULEB();
+					format.push_back(std::make_pair(type, form));
+				}
+
+				uint64 count = reader.ULEB();
+				for (uint64 i = 0; i < count && !reader.isFailed; ++i)
+				{
+					const char* path = "";
+					uint64 directory = 0;
+					if (!ReadEntry(reader, format, offsetSize, debugLineStr, debugStr, path, directory))
+					{
+						reader.isFailed = true;
+						break;
+					}
+
+					if (table == 0)
+						directories.push_back(path);
+					else
+						AddFile(path, directory);
+				}
+			}
+		}
+		else
+		{
+			// Directory 0 is the compilation directory which is stored in .debug_info
+			directories.push_back("");
+			while (const char* directory = reader.String())
+			{
+				if (*directory == '\0' || reader.isFailed)
+					break;
+				directories.push_back(directory);
+			}
+
+			// File indices start from 1
+			fileIndices.push_back(0);
+			if (files.empty())
+				files.push_back(string());
+
+			while (const char* path = reader.String())
+			{
+				if (*path == '\0' || reader.isFailed)
+					break;
+				uint64 directory = reader.ULEB();
+				reader.ULEB(); // mtime
+				reader.ULEB(); // length
+				AddFile(path, directory);
+			}
+		}
+
+		if (reader.isFailed || program > reader.finish)
+			continue;
+
+		reader.cursor = program;
+
+		// State machine
+		uint64 address = 0;
+		uint64 file = 1;
+		int64 line = 1;
+		bool isValidSequence = true;
+
+		auto EmitRow = [&](bool isEndOfSequence)
+		{
+			if (!isValidSequence)
+				return;
+
+			Row row;
+			row.address = address;
+			row.file = file < fileIndices.size() ? fileIndices[file] : 0;
+			row.line = isEndOfSequence ? 0 : (uint32)std::max<int64>(line, 1);
+			rows.push_back(row);
+		};
+
+		while (reader.cursor < reader.finish && !reader.isFailed)
+		{
+			uint8_t opcode = reader.U8();
+
+			if (opcode >= opcodeBase)
+			{
+				uint32 adjusted = opcode - opcodeBase;
+				address += (adjusted / lineRange) * minInstructionLength;
+				line += lineBase + (int)(adjusted % lineRange);
+				EmitRow(false);
+			}
+			else if (opcode == 0)
+			{
+				uint64 size = reader.ULEB();
+				const uint8_t* next = reader.cursor + size;
+				if (size == 0 || !reader.Has(size))
+					break;
+
+				uint8_t extended = reader.U8();
+				switch (extended)
+				{
+				case DW_LNE_end_sequence:
+					EmitRow(true);
+					address = 0;
+					file = 1;
+					line = 1;
+					isValidSequence = true;
+					break;
+
+				case DW_LNE_set_address:
+					address = reader.Read(std::min<size_t>(size - 1, sizeof(uint64)));
+					// Code removed by the linker (--gc-sections) is marked with 0 or -1
+					isValidSequence = address != 0 && address != (uint64)-1 && address != 0xFFFFFFFF;
+					break;
+
+				case DW_LNE_define_file:
+				{
+					const char* path = reader.String();
+					uint64 directory = reader.ULEB();
+					AddFile(path, directory);
+					break;
+				}
+				}
+
+				reader.cursor = next;
+			}
+			else
+			{
+				switch (opcode)
+				{
+				case DW_LNS_copy: EmitRow(false); break;
+				case DW_LNS_advance_pc: address += reader.ULEB() * minInstructionLength; break;
+				case DW_LNS_advance_line: line += reader.SLEB(); break;
+				case DW_LNS_set_file: file = reader.ULEB(); break;
+				case DW_LNS_const_add_pc: address += ((255 - opcodeBase) / lineRange) * minInstructionLength; break;
+				case DW_LNS_fixed_advance_pc: address += reader.U16(); break;
+				default:
+					// DW_LNS_set_column, DW_LNS_set_isa and unknown opcodes
+					for (uint8_t i = 0; i < opcodeLengths[opcode]; ++i)
+						reader.ULEB();
+					break;
+				}
+			}
+		}
+	}
+
+	std::stable_sort(rows.begin(), rows.end());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const DwarfLineTable::Row* DwarfLineTable::Find(uint64 address) const
+{
+	Row key;
+	key.address = address;
+	auto it = std::upper_bound(rows.begin(), rows.end(), key);
+	if (it == rows.begin())
+		return nullptr;
+
+	const Row& row = *(it - 1);
+	return row.line != 0 ? &row : nullptr;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loaded module: symbol tables, line tables and the persistent cache of the resolved symbols (per build-id)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ElfModule
+{
+	struct Function
+	{
+		uint64 address;
+		uint64 size;
+		const char* name;
+		bool operator<(const Function& other) const { return address < other.address; }
+	};
+
+	struct CachedSymbol
+	{
+		uint64 offset;
+		uint32 line;
+		string function;
+		string file;
+		// Resolved during this session (the others are dropped first when the cache is over the limit)
+		bool isUsed;
+	};
+
+	ElfFile image;
+	ElfFile debugImage;
+
+	vector<Function> functions;
+	DwarfLineTable lineTable;
+	bool isParsed;
+
+	// Key: address relative to the bias
+	unordered_map<uint64, CachedSymbol> cache;
+	string cachePath;
+	bool isCacheDirty;
+
+	std::mutex lock;
+
+	void Parse();
+	void ParseSymbols(ElfFile& file, const char* name);
+	void LoadCache();
+public:
+	string path;
+	uint64 base;
+	uint64 begin;
+	uint64 end;
+	int64 bias;
+
+	ElfModule(const char* modulePath) : isParsed(false), isCacheDirty(false), path(modulePath), base(0), begin(0), end(0), bias(0) {}
+	~ElfModule() { SaveCache(); }
+
+	bool Open(const char* cacheDirectory);
+	void Resolve(uint64 address, Symbol& symbol);
+	void SaveCache();
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ElfModule::Open(const char* cacheDirectory)
+{
+	if (!image.Open(path.c_str()))
+		return false;
+
+	bias = (int64)(base - image.GetImageBase());
+
+	string buildID = image.GetBuildID();
+	if (!buildID.empty() && cacheDirectory != nullptr)
+	{
+		cachePath = cacheDirectory;
+		cachePath += "/" + buildID + ".cache";
+		LoadCache();
+	}
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ElfModule::Parse()
+{
+	isParsed = true;
+
+	ParseSymbols(image, ".symtab");
+	ParseSymbols(image, ".dynsym");
+
+	// Stripped binaries: looking for the separate debug file
+	ElfFile* debugFile = &image;
+	if (image.FindSectionHeader(".debug_line") == nullptr || image.FindSectionHeader(".symtab") == nullptr)
+	{
+		string buildID = image.GetBuildID();
+		if (buildID.size() > 2)
+		{
+			string debugPath = string(DEBUG_BUILD_ID_PATH) + "/" + buildID.substr(0, 2) + "/" + buildID.substr(2) + ".debug";
+			if (debugImage.Open(debugPath.c_str()))
+			{
+				ParseSymbols(debugImage, ".symtab");
+				debugFile = &debugImage;
+			}
+		}
+	}
+
+	std::sort(functions.begin(), functions.end());
+
+	ElfFile::Section debugLine, debugLineStr, debugStr;
+	if (debugFile->GetSection(".debug_line", debugLine))
+	{
+		debugFile->GetSection(".debug_line_str", debugLineStr);
+		debugFile->GetSection(".debug_str", debugStr);
+		lineTable.Parse(debugLine, debugLineStr, debugStr);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ElfModule::ParseSymbols(ElfFile& file, const char* name)
+{
+	const ElfW(Shdr)* header = file.FindSectionHeader(name);
+	if (header == nullptr || header->sh_entsize != sizeof(ElfW(Sym)))
+		return;
+
+	ElfFile::Section symbols, names;
+	if (!file.GetSection(header, symbols) || !file.GetSection(file.GetSectionHeader(header->sh_link), names))
+		return;
+
+	size_t count = symbols.size / sizeof(ElfW(Sym));
+	for (size_t i = 0; i < count; ++i)
+	{
+		ElfW(Sym) symbol;
+		memcpy(&symbol, symbols.data + i * sizeof(ElfW(Sym)), sizeof(symbol));
+
+		int type = ELF64_ST_TYPE(symbol.st_info); // Same encoding for ELF32
+		if ((type != STT_FUNC && type != STT_GNU_IFUNC) || symbol.st_shndx == SHN_UNDEF || symbol.st_value == 0 || symbol.st_name >= names.size)
+			continue;
+
+		Function function;
+		function.address = symbol.st_value;
+		function.size = symbol.st_size;
+		function.name = (const char*)names.data + symbol.st_name;
+		functions.push_back(function);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ElfModule::Resolve(uint64 address, Symbol& symbol)
+{
+	uint64 relativeAddress = address - (uint64)bias;
+
+	// Symbols of the same module could be resolved from several threads at the same time
+	const CachedSymbol* cached = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto it = cache.find(relativeAddress);
+		if (it != cache.end())
+		{
+			cached = &it->second;
+			it->second.isUsed = true;
+		}
+		else if (!isParsed)
+		{
+			Parse();
+		}
+	}
+
+	if (cached == nullptr)
+	{
+		CachedSymbol resolved;
+		resolved.offset = 0;
+		resolved.line = 0;
+		resolved.isUsed = true;
+
+		Function key;
+		key.address = relativeAddress;
+		auto it = std::upper_bound(functions.begin(), functions.end(), key);
+		if (it != functions.begin())
+		{
+			const Function& function = *(it - 1);
+			if (function.size == 0 || relativeAddress < function.address + function.size)
+			{
+				int status = 0;
+				char* demangled = abi::__cxa_demangle(function.name, nullptr, nullptr, &status);
+				resolved.function = (status == 0 && demangled) ? demangled : function.name;
+				resolved.offset = relativeAddress - function.address;
+				free(demangled);
+			}
+		}
+
+		if (const DwarfLineTable::Row* row = lineTable.Find(relativeAddress))
+		{
+			resolved.file = lineTable.files[row->file];
+			resolved.line = row->line;
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		cached = &cache.insert(std::make_pair(relativeAddress, resolved)).first->second;
+		isCacheDirty = true;
+	}
+
+	// Elements of unordered_map are never relocated
+	symbol.offset = cached->offset;
+	symbol.line = cached->line;
+	symbol.function = ToWideString(cached->function.c_str());
+	symbol.file = ToWideString(cached->file.c_str());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ElfModule::LoadCache()
+{
+	FILE* file = fopen(cachePath.c_str(), "rb");
+	if (file == nullptr)
+		return;
+
+	// {Magic, Version, Count, Count x {Offset, SymbolOffset, Line, FunctionLength, Function, FileLength, File}, Magic}
+	unordered_map<uint64, CachedSymbol> loaded;
+	bool isValid = false;
+
+	uint32 header[3] = { 0 };
+	if (fread(header, sizeof(header), 1, file) == 1 && header[0] == SYMBOL_CACHE_MAGIC && header[1] == SYMBOL_CACHE_VERSION && header[2] <= SYMBOL_CACHE_MAX_ENTRIES)
+	{
+		uint32 count = 0;
+		for (; count < header[2]; ++count)
+		{
+			uint64 address = 0;
+			uint32 lengths[2] = { 0 };
+			CachedSymbol symbol;
+			symbol.isUsed = false;
+
+			if (fread(&address, sizeof(address), 1, file) != 1 || fread(&symbol.offset, sizeof(symbol.offset), 1, file) != 1 || fread(&symbol.line, sizeof(symbol.line), 1, file) != 1)
+				break;
+
+			if (fread(&lengths[0], sizeof(uint32), 1, file) != 1 || lengths[0] > SYMBOL_CACHE_MAX_STRING)
+				break;
+			symbol.function.resize(lengths[0]);
+			if (lengths[0] && fread(&symbol.function[0], lengths[0], 1, file) != 1)
+				break;
+
+			if (fread(&lengths[1], sizeof(uint32), 1, file) != 1 || lengths[1] > SYMBOL_CACHE_MAX_STRING)
+				break;
+			symbol.file.resize(lengths[1]);
+			if (lengths[1] && fread(&symbol.file[0], lengths[1], 1, file) != 1)
+				break;
+
+			loaded[address] = symbol;
+		}
+
+		// Trailing magic protects from the truncated files
+		uint32 footer = 0;
+		isValid = count == header[2] && fread(&footer, sizeof(footer), 1, file) == 1 && footer == SYMBOL_CACHE_MAGIC;
+	}
+
+	fclose(file);
+
+	if (isValid)
+	{
+		cache.swap(loaded);
+		// Keeps the recently used caches away from the pruning (see PruneCacheDirectory)
+		utimes(cachePath.c_str(), nullptr);
+	}
+	else
+	{
+		// Broken or outdated file is replaced on save
+		isCacheDirty = true;
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ElfModule::SaveCache()
+{
+	if (!isCacheDirty || cachePath.empty())
+		return;
+
+	// Writing to a temporary file first: other processes might be reading the cache at the same time
+	string tempPath = cachePath;
+	char suffix[32] = { 0 };
+	sprintf_s(suffix, ".%d", (int)getpid());
+	tempPath += suffix;
+
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == nullptr)
+		return;
+
+	// Symbols resolved during this session go first, the rest fills the cache up to the limit
+	vector<std::pair<uint64, const CachedSymbol*>> entries;
+	for (int isUsed = 1; isUsed >= 0; --isUsed)
+		for (auto it = cache.begin(); it != cache.end() && entries.size() < SYMBOL_CACHE_MAX_ENTRIES; ++it)
+			if (it->second.isUsed == (isUsed != 0) && it->second.function.size() <= SYMBOL_CACHE_MAX_STRING && it->second.file.size() <= SYMBOL_CACHE_MAX_STRING)
+				entries.push_back(std::make_pair(it->first, &it->second));
+
+	uint32 header[3] = { SYMBOL_CACHE_MAGIC, SYMBOL_CACHE_VERSION, (uint32)entries.size() };
+	bool isWritten = fwrite(header, sizeof(header), 1, file) == 1;
+
+	for (auto it = entries.begin(); it != entries.end() && isWritten; ++it)
+	{
+		const CachedSymbol& symbol = *it->second;
+		uint32 functionLength = (uint32)symbol.function.size();
+		uint32 fileLength = (uint32)symbol.file.size();
+
+		isWritten = fwrite(&it->first, sizeof(it->first), 1, file) == 1
+			&& fwrite(&symbol.offset, sizeof(symbol.offset), 1, file) == 1
+			&& fwrite(&symbol.line, sizeof(symbol.line), 1, file) == 1
+			&& fwrite(&functionLength, sizeof(functionLength), 1, file) == 1
+			&& (functionLength == 0 || fwrite(symbol.function.data(), functionLength, 1, file) == 1)
+			&& fwrite(&fileLength, sizeof(fileLength), 1, file) == 1
+			&& (fileLength == 0 || fwrite(symbol.file.data(), fileLength, 1, file) == 1);
+	}
+
+	isWritten = isWritten && fwrite(&SYMBOL_CACHE_MAGIC, sizeof(SYMBOL_CACHE_MAGIC), 1, file) == 1;
+	isWritten &= fclose(file) == 0;
+
+	if (isWritten && rename(tempPath.c_str(), cachePath.c_str()) == 0)
+		isCacheDirty = false;
+	else
+		unlink(tempPath.c_str());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class LinuxSymbolEngine : public SymbolEngine
+{
+	typedef unordered_map<uint64, Symbol> SymbolCache;
+	SymbolCache cache;
+
+	vector<Module> modules;
+	vector<ElfModule*> elfModules;
+	bool isInitialized;
+
+	string cacheDirectory;
+
+	void Init();
+	void InitCacheDirectory();
+	void PruneCacheDirectory();
+	ElfModule* FindModule(uint64 address);
+public:
+	LinuxSymbolEngine() : isInitialized(false) {}
+	~LinuxSymbolEngine();
+
+	virtual const Symbol* GetSymbol(uint64 address) override;
+	virtual void GetSymbols(const uint64* addresses, size_t count, const Symbol** symbols) override;
+	virtual const vector<Module>& GetModules() override;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+LinuxSymbolEngine::~LinuxSymbolEngine()
+{
+	for (ElfModule* module : elfModules)
+		Memory::Delete(module);
+	elfModules.clear();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxSymbolEngine::InitCacheDirectory()
+{
+	// OPTICK_SYMBOL_CACHE=<path> overrides the default location, empty value disables the cache
+	if (const char* path = getenv(SYMBOL_CACHE_ENV))
+	{
+		cacheDirectory = path;
+	}
+	else if (const char* xdgCache = getenv("XDG_CACHE_HOME"))
+	{
+		cacheDirectory = string(xdgCache) + "/optick/symbols";
+	}
+	else if (const char* home = getenv("HOME"))
+	{
+		cacheDirectory = string(home) + "/.cache/optick/symbols";
+	}
+
+	// mkdir -p
+	for (size_t pos = 1; pos <= cacheDirectory.size(); ++pos)
+	{
+		if (pos == cacheDirectory.size() || cacheDirectory[pos] == '/')
+		{
+			string directory = cacheDirectory.substr(0, pos);
+			if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+			{
+				cacheDirectory.clear();
+				break;
+			}
+		}
+	}
+
+	if (!cacheDirectory.empty())
+		PruneCacheDirectory();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxSymbolEngine::PruneCacheDirectory()
+{
+	DIR* directory = opendir(cacheDirectory.c_str());
+	if (directory == nullptr)
+		return;
+
+	struct CacheFile
+	{
+		string path;
+		uint64 size;
+		time_t time;
+	};
+
+	vector<CacheFile> files;
+	uint64 totalSize = 0;
+
+	while (dirent* entry = readdir(directory))
+	{
+		const char* extension = strstr(entry->d_name, ".cache");
+		if (extension == nullptr)
+			continue;
+
+		string path = cacheDirectory + "/" + entry->d_name;
+
+		// <build-id>.cache.<pid> - temporary file of a writer which has crashed
+		if (extension[strlen(".cache")] == '.')
+		{
+			int pid = atoi(extension + strlen(".cache."));
+			if (pid > 0 && kill(pid, 0) != 0 && errno == ESRCH)
+				unlink(path.c_str());
+			continue;
+		}
+
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			continue;
+
+		CacheFile file = { path, (uint64)info.st_size, info.st_mtime };
+		files.push_back(file);
+		totalSize += file.size;
+	}
+	closedir(directory);
+
+	// The least recently used caches go first
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.time < b.time; });
+
+	for (size_t i = 0; i < files.size() && totalSize > SYMBOL_CACHE_MAX_DIRECTORY_SIZE; ++i)
+	{
+		if (unlink(files[i].path.c_str()) == 0)
+			totalSize -= files[i].size;
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxSymbolEngine::Init()
+{
+	if (isInitialized)
+		return;
+
+	isInitialized = true;
+
+	InitCacheDirectory();
+
+	FILE* file = fopen(PROC_SELF_MAPS, "r");
+	if (file == nullptr)
+		return;
+
+	// 7f2cc49eb000-7f2cc4a0c000 r-xp 00028000 fd:01 1234567 /usr/lib/x86_64-linux-gnu/libc.so.6
+	char line[1024];
+	while (fgets(line, sizeof(line), file))
+	{
+		unsigned long long start = 0, finish = 0, offset = 0;
+		char permissions[8] = { 0 };
+		int pathOffset = 0;
+
+		if (sscanf(line, "%llx-%llx %7s %llx %*s %*s %n", &start, &finish, permissions, &offset, &pathOffset) < 4 || pathOffset == 0)
+			continue;
+
+		char* modulePath = line + pathOffset;
+		modulePath[strcspn(modulePath, "\n")] = '\0';
+
+		// Anonymous mappings, [vdso], [stack], deleted files
+		if (modulePath[0] != '/' || strstr(modulePath, " (deleted)"))
+			continue;
+
+		ElfModule* module = elfModules.empty() ? nullptr : elfModules.back();
+		if (module == nullptr || module->path != modulePath)
+		{
+			module = Memory::New<ElfModule>(modulePath);
+			module->base = start - offset;
+			module->begin = start;
+			elfModules.push_back(module);
+		}
+		module->end = finish;
+	}
+	fclose(file);
+
+	// Keeping only ELF images (skipping mapped data files)
+	vector<ElfModule*> images;
+	for (ElfModule* module : elfModules)
+	{
+		if (module->Open(cacheDirectory.empty() ? nullptr : cacheDirectory.c_str()))
+		{
+			images.push_back(module);
+			modules.push_back(Module(module->path.c_str(), (void*)module->begin, (size_t)(module->end - module->begin)));
+		}
+		else
+		{
+			Memory::Delete(module);
+		}
+	}
+	elfModules.swap(images);
+
+	std::sort(elfModules.begin(), elfModules.end(), [](const ElfModule* a, const ElfModule* b) { return a->begin < b->begin; });
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ElfModule* LinuxSymbolEngine::FindModule(uint64 address)
+{
+	auto it = std::upper_bound(elfModules.begin(), elfModules.end(), address, [](uint64 value, const ElfModule* module) { return value < module->begin; });
+	if (it == elfModules.begin())
+		return nullptr;
+
+	ElfModule* module = *(it - 1);
+	return address < module->end ? module : nullptr;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const Symbol* LinuxSymbolEngine::GetSymbol(uint64 address)
+{
+	if (address == 0)
+		return nullptr;
+
+	Init();
+
+	Symbol& symbol = cache[address];
+
+	if (symbol.address != 0)
+		return &symbol;
+
+	symbol.address = address;
+
+	if (ElfModule* module = FindModule(address))
+		module->Resolve(address, symbol);
+
+	return &symbol;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxSymbolEngine::GetSymbols(const uint64* addresses, size_t count, const Symbol** symbols)
+{
+	Init();
+
+	// Preparing all the output symbols on the calling thread, workers resolve them in batches
+	vector<std::pair<ElfModule*, Symbol*>> tasks;
+	for (size_t i = 0; i < count; ++i)
+	{
+		symbols[i] = nullptr;
+
+		uint64 address = addresses[i];
+		if (address == 0)
+			continue;
+
+		Symbol& symbol = cache[address];
+		symbols[i] = &symbol;
+
+		if (symbol.address != 0)
+			continue;
+
+		symbol.address = address;
+
+		if (ElfModule* module = FindModule(address))
+			tasks.push_back(std::make_pair(module, &symbol));
+	}
+
+	// Keeping the addresses of the same module together (better locality for symbol tables)
+	std::sort(tasks.begin(), tasks.end(), [](const std::pair<ElfModule*, Symbol*>& a, const std::pair<ElfModule*, Symbol*>& b) { return a.first->begin < b.first->begin || (a.first == b.first && a.second->address < b.second->address); });
+
+	std::atomic<size_t> nextBatch(0);
+	auto Worker = [&tasks, &nextBatch]()
+	{
+		for (size_t start = nextBatch.fetch_add(SYMBOL_ENGINE_BATCH_SIZE); start < tasks.size(); start = nextBatch.fetch_add(SYMBOL_ENGINE_BATCH_SIZE))
+		{
+			size_t finish = std::min(start + SYMBOL_ENGINE_BATCH_SIZE, tasks.size());
+			for (size_t i = start; i < finish; ++i)
+				tasks[i].first->Resolve(tasks[i].second->address, *tasks[i].second);
+		}
+	};
+
+	uint32 threadCount = std::min<uint32>(std::max(std::thread::hardware_concurrency(), 1u), SYMBOL_ENGINE_MAX_THREAD_COUNT);
+	threadCount = (uint32)std::min<size_t>(threadCount, (tasks.size() + SYMBOL_ENGINE_BATCH_SIZE - 1) / SYMBOL_ENGINE_BATCH_SIZE);
+
+	vector<std::thread> workers;
+	for (uint32 i = 1; i < threadCount; ++i)
+		workers.push_back(std::thread([&Worker]() { Memory::InitThread(); Worker(); }));
+
+	// Calling thread participates as well
+	Worker();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const vector<Module>& LinuxSymbolEngine::GetModules()
+{
+	Init();
+	return modules;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SymbolEngine* Platform::CreateSymbolEngine()
+{
+	return Memory::New<LinuxSymbolEngine>();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hardware counters
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const uint64 HW_COUNTER_CONFIGS[HWCounterValues::COUNT] =
+{
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES,
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class LinuxHWCounters : public HWCounters
+{
+	struct Counter
+	{
+		int fd;
+		volatile perf_event_mmap_page* page;
+		Counter() : fd(-1), page(nullptr) {}
+	};
+	array<Counter, HWCounterValues::COUNT> counters;
+
+	static uint64 ReadCounter(const Counter& counter);
+public:
+	~LinuxHWCounters();
+
+	bool Open(pid_t threadID);
+
+	virtual void Read(HWCounterValues& values) override;
+	virtual bool ReadTotal(HWCounterValues& values) override;
+	virtual void Start() override;
+	virtual void Stop() override;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+LinuxHWCounters::~LinuxHWCounters()
+{
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	for (Counter& counter : counters)
+	{
+		if (counter.page != nullptr)
+			munmap((void*)counter.page, pageSize);
+
+		if (counter.fd >= 0)
+			close(counter.fd);
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LinuxHWCounters::Open(pid_t threadID)
+{
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	for (int i = 0; i < HWCounterValues::COUNT; ++i)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(perf_event_attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = HW_COUNTER_CONFIGS[i];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// Siblings follow the state of the group leader (scheduled onto the PMU together)
+		attr.disabled = (i == 0) ? 1 : 0;
+
+		int groupFD = counters[0].fd;
+
+		Counter& counter = counters[i];
+		counter.fd = (int)syscall(SYS_perf_event_open, &attr, threadID, -1, groupFD, PERF_FLAG_FD_CLOEXEC);
+
+		// No PMU (e.g. virtual machines) - the rest of the counters are optional
+		if (counter.fd < 0)
+		{
+			if (i == 0)
+				return false;
+			continue;
+		}
+
+		// User page exposes the index of the hardware counter for rdpmc
+		void* page = mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, counter.fd, 0);
+		counter.page = (page != MAP_FAILED) ? (volatile perf_event_mmap_page*)page : nullptr;
+	}
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64 LinuxHWCounters::ReadCounter(const Counter& counter)
+{
+	if (counter.fd < 0)
+		return 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+	// Seqlock protocol from include/uapi/linux/perf_event.h
+	if (volatile perf_event_mmap_page* page = counter.page)
+	{
+		for (;;)
+		{
+			uint32 seq = page->lock;
+			std::atomic_signal_fence(std::memory_order_acquire);
+
+			uint32 index = page->index;
+			if (!page->cap_user_rdpmc || index == 0)
+				break; // Counter is not scheduled on the PMU right now
+
+			int64 count = page->offset;
+
+			uint32 low = 0, high = 0;
+			__asm__ volatile("rdpmc" : "=a" (low), "=d" (high) : "c" (index - 1));
+
+			uint16 width = page->pmc_width;
+			int64 pmc = (int64)(((uint64)high << 32) | low);
+			pmc <<= 64 - width;
+			pmc >>= 64 - width;
+
+			std::atomic_signal_fence(std::memory_order_acquire);
+			if (page->lock == seq)
+				return (uint64)(count + pmc);
+		}
+	}
+#endif
+
+	uint64 value = 0;
+	return read(counter.fd, &value, sizeof(value)) == sizeof(value) ? value : 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxHWCounters::Read(HWCounterValues& values)
+{
+	for (int i = 0; i < HWCounterValues::COUNT; ++i)
+		values.values[i] = ReadCounter(counters[i]);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LinuxHWCounters::ReadTotal(HWCounterValues& values)
+{
+	for (int i = 0; i < HWCounterValues::COUNT; ++i)
+	{
+		uint64 value = 0;
+		if (counters[i].fd < 0 || read(counters[i].fd, &value, sizeof(value)) != sizeof(value))
+			value = 0;
+		values.values[i] = value;
+	}
+	return counters[0].fd >= 0;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxHWCounters::Start()
+{
+	ioctl(counters[0].fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(counters[0].fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxHWCounters::Stop()
+{
+	ioctl(counters[0].fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HWCounters* Platform::CreateHWCounters(ThreadID threadID)
+{
+	LinuxHWCounters* counters = Memory::New<LinuxHWCounters>();
+
+	if (!counters->Open((pid_t)threadID))
+	{
+		Memory::Delete(counters);
+		return nullptr;
+	}
+
+	return counters;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Process-level counters from /proc and getrusage (the files are kept open and re-read with pread)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class LinuxSystemCounters : public SystemCounters
+{
+	struct ThreadStat
+	{
+		int fd;
+		uint64 waitTime;
+		const EventDescription* description; // nullptr if the thread is accounted in the total only
+		ThreadStat() : fd(-1), waitTime(0), description(nullptr) {}
+	};
+	unordered_map<pid_t, ThreadStat> threadStats;
+
+	// Names of the per-thread tracks created by the process (the board keeps them alive between the captures)
+	static unordered_set<StringHash> threadTrackNames;
+
+	struct FrequencyStat
+	{
+		int fd;
+		const EventDescription* description;
+	};
+	vector<FrequencyStat> frequencyStats;
+
+	int statmFD;
+	long pageSize;
+	rusage usage;
+
+	const EventDescription* rssDescription;
+	const EventDescription* minorFaultsDescription;
+	const EventDescription* majorFaultsDescription;
+	const EventDescription* voluntarySwitchesDescription;
+	const EventDescription* involuntarySwitchesDescription;
+	const EventDescription* runQueueDescription;
+
+	static bool ReadValues(int fd, uint64* values, int count);
+	void ScanThreads();
+public:
+	LinuxSystemCounters();
+	~LinuxSystemCounters();
+
+	virtual void Sample(EventStorage& storage, int64 timestamp) override;
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+unordered_set<StringHash> LinuxSystemCounters::threadTrackNames;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LinuxSystemCounters::ReadValues(int fd, uint64* values, int count)
+{
+	char buffer[256];
+	ssize_t length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+	if (length <= 0)
+		return false;
+
+	buffer[length] = '\0';
+
+	char* text = buffer;
+	for (int i = 0; i < count; ++i)
+	{
+		char* end = nullptr;
+		values[i] = strtoull(text, &end, 10);
+		if (end == text)
+			return false;
+		text = end;
+	}
+
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+LinuxSystemCounters::LinuxSystemCounters() : pageSize(sysconf(_SC_PAGESIZE))
+{
+	rssDescription = EventDescription::CreateShared("RSS (MB)", __FILE__, __LINE__);
+	minorFaultsDescription = EventDescription::CreateShared("Minor Page Faults", __FILE__, __LINE__);
+	majorFaultsDescription = EventDescription::CreateShared("Major Page Faults", __FILE__, __LINE__);
+	voluntarySwitchesDescription = EventDescription::CreateShared("Voluntary Context Switches", __FILE__, __LINE__);
+	involuntarySwitchesDescription = EventDescription::CreateShared("Involuntary Context Switches", __FILE__, __LINE__);
+	runQueueDescription = EventDescription::CreateShared("Run Queue Wait (ms)", __FILE__, __LINE__);
+
+	statmFD = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	// cpufreq is missing on most of the virtual machines
+	long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+	for (long cpu = 0; cpu < cpuCount; ++cpu)
+	{
+		char path[128];
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/cpufreq/scaling_cur_freq", cpu);
+
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		char name[64];
+		snprintf(name, sizeof(name), "CPU %ld Frequency (MHz)", cpu);
+
+		FrequencyStat stat;
+		stat.fd = fd;
+		stat.description = EventDescription::CreateShared(name);
+		frequencyStats.push_back(stat);
+	}
+
+	ScanThreads();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+LinuxSystemCounters::~LinuxSystemCounters()
+{
+	if (statmFD >= 0)
+		close(statmFD);
+
+	for (const FrequencyStat& stat : frequencyStats)
+		close(stat.fd);
+
+	for (auto& it : threadStats)
+		if (it.second.fd >= 0)
+			close(it.second.fd);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxSystemCounters::ScanThreads()
+{
+	DIR* taskDir = opendir("/proc/self/task");
+	if (!taskDir)
+		return;
+
+	while (dirent* taskEntry = readdir(taskDir))
+	{
+		pid_t tid = (pid_t)strtol(taskEntry->d_name, nullptr, 10);
+		if (tid <= 0 || threadStats.find(tid) != threadStats.end())
+			continue;
+
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", tid);
+
+		ThreadStat stat;
+		stat.fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (stat.fd < 0)
+			continue;
+
+		// schedstat: time on cpu (ns), time waiting on a runqueue (ns), number of timeslices
+		uint64 values[2];
+		if (ReadValues(stat.fd, values, 2))
+			stat.waitTime = values[1];
+
+		char threadName[32] = { 0 };
+		snprintf(path, sizeof(path), "/proc/self/task/%d/comm", tid);
+		int commFD = open(path, O_RDONLY | O_CLOEXEC);
+		if (commFD >= 0)
+		{
+			ssize_t length = read(commFD, threadName, sizeof(threadName) - 1);
+			if (length > 0 && threadName[length - 1] == '\n')
+				threadName[length - 1] = '\0';
+			close(commFD);
+		}
+
+		char name[96];
+		snprintf(name, sizeof(name), "Run Queue Wait (ms): %s [%d]", threadName, tid);
+
+		StringHash nameHash(name);
+		if (threadTrackNames.find(nameHash) != threadTrackNames.end() || threadTrackNames.size() < RUN_QUEUE_MAX_THREAD_TRACKS)
+		{
+			threadTrackNames.insert(nameHash);
+			stat.description = EventDescription::CreateShared(name);
+		}
+
+		threadStats[tid] = stat;
+	}
+
+	closedir(taskDir);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinuxSystemCounters::Sample(EventStorage& storage, int64 timestamp)
+{
+	// statm: total program size, resident set size (pages)
+	uint64 memory[2];
+	if (statmFD >= 0 && ReadValues(statmFD, memory, 2))
+		storage.tagFloatBuffer.Add(TagFloat(*rssDescription, (float)(memory[1] * pageSize / (1024.0 * 1024.0)), timestamp));
+
+	// Accumulated over all the threads of the process
+	rusage current;
+	if (getrusage(RUSAGE_SELF, &current) == 0)
+	{
+		storage.tagU32Buffer.Add(TagU32(*minorFaultsDescription, (uint32)(current.ru_minflt - usage.ru_minflt), timestamp));
+		storage.tagU32Buffer.Add(TagU32(*majorFaultsDescription, (uint32)(current.ru_majflt - usage.ru_majflt), timestamp));
+		storage.tagU32Buffer.Add(TagU32(*voluntarySwitchesDescription, (uint32)(current.ru_nvcsw - usage.ru_nvcsw), timestamp));
+		storage.tagU32Buffer.Add(TagU32(*involuntarySwitchesDescription, (uint32)(current.ru_nivcsw - usage.ru_nivcsw), timestamp));
+		usage = current;
+	}
+
+	// Picking up new threads (only the new ones open their files)
+	ScanThreads();
+
+	// Only the threads that were actually waiting for a CPU during the interval
+	uint64 totalWaitTime = 0;
+	for (auto it = threadStats.begin(); it != threadStats.end();)
+	{
+		ThreadStat& stat = it->second;
+
+		uint64 values[2];
+		if (!ReadValues(stat.fd, values, 2))
+		{
+			// Thread has exited
+			close(stat.fd);
+			it = threadStats.erase(it);
+			continue;
+		}
+
+		if (values[1] > stat.waitTime)
+		{
+			totalWaitTime += values[1] - stat.waitTime;
+
+			if (stat.description)
+				storage.tagFloatBuffer.Add(TagFloat(*stat.description, (float)((values[1] - stat.waitTime) / 1000000.0), timestamp));
+		}
+
+		stat.waitTime = values[1];
+		++it;
+	}
+
+	storage.tagFloatBuffer.Add(TagFloat(*runQueueDescription, (float)(totalWaitTime / 1000000.0), timestamp));
+
+	for (const FrequencyStat& stat : frequencyStats)
+	{
+		uint64 frequencyKHz = 0;
+		if (ReadValues(stat.fd, &frequencyKHz, 1))
+			storage.tagU32Buffer.Add(TagU32(*stat.description, (uint32)(frequencyKHz / 1000), timestamp));
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SystemCounters* Platform::CreateSystemCounters()
+{
+	return Memory::New<LinuxSystemCounters>();
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
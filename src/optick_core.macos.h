@@ -27,6 +27,7 @@
 #if USE_OPTICK
 
 #include "optick_core.platform.h"
+#include "optick_core.posix.h"
 
 #include <mach/mach_time.h>
 #include <sys/time.h>
@@ -64,6 +65,22 @@ namespace Optick
 		clock_gettime(CLOCK_REALTIME, &ts);
 		return ts.tv_sec * 1000000000LL + ts.tv_nsec;
 	}
+
+	int64 Platform::GetThreadCPUTime()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	}
+
+	bool Platform::GetThreadStack(uint64& begin, uint64& end)
+	{
+		// pthread_get_stackaddr_np returns the top of the stack
+		pthread_t thread = pthread_self();
+		end = (uint64)pthread_get_stackaddr_np(thread);
+		begin = end - (uint64)pthread_get_stacksize_np(thread);
+		return end != 0;
+	}
 }
 
 #if OPTICK_ENABLE_TRACING
@@ -303,6 +320,16 @@ SymbolEngine* Platform::CreateSymbolEngine()
 	return nullptr;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HWCounters* Platform::CreateHWCounters(ThreadID)
+{
+	return nullptr;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SystemCounters* Platform::CreateSystemCounters()
+{
+	return nullptr;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
 #endif //OPTICK_ENABLE_TRACING
 #endif //USE_OPTICK
@@ -34,9 +34,14 @@
 namespace Optick
 {
 	struct Trace;
+	struct ThreadEntry;
 	struct Module;
 	struct Symbol;
 	struct SymbolEngine;
+	struct HWCounters;
+	struct HWCounterValues;
+	struct SystemCounters;
+	struct EventStorage;
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Platform API
@@ -53,10 +58,20 @@ namespace Optick
 		static OPTICK_INLINE int64 GetFrequency();
 		// CPU Time (Ticks)
 		static OPTICK_INLINE int64 GetTime();
+		// CPU Time consumed by the calling thread (Nanoseconds)
+		static OPTICK_INLINE int64 GetThreadCPUTime();
+		// Return addresses of the calling thread (from leaf to root)
+		static OPTICK_INLINE uint32 GetCallstack(uint64* callstack, uint32 maxCount);
+		// Stack bounds of the calling thread [begin, end)
+		static OPTICK_INLINE bool GetThreadStack(uint64& begin, uint64& end);
 		// System Tracer
 		static OPTICK_INLINE Trace* CreateTrace();
 		// Symbol Resolver
 		static OPTICK_INLINE SymbolEngine* CreateSymbolEngine();
+		// Hardware Counters (per thread)
+		static OPTICK_INLINE HWCounters* CreateHWCounters(ThreadID threadID);
+		// Process-level counters (memory, page faults, scheduler stats)
+		static OPTICK_INLINE SystemCounters* CreateSystemCounters();
 	};
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -67,6 +82,8 @@ namespace Optick
 		virtual void SetPassword(const char* /*pwd*/) {};
 		virtual CaptureStatus::Type Start(Mode::Type mode, int frequency, const ThreadList& threads) = 0;
 		virtual bool Stop() = 0;
+		// New thread is registered while the tracer is active
+		virtual void AddThread(const ThreadEntry* /*entry*/) {}
 		virtual ~Trace() {};
 	};
 
@@ -106,8 +123,44 @@ namespace Optick
 		// Get Symbol from address
 		virtual const Symbol* GetSymbol(uint64 dwAddress) = 0;
 
+		// Get Symbols for a batch of addresses (engines with thread-safe backends resolve them in parallel)
+		virtual void GetSymbols(const uint64* addresses, size_t count, const Symbol** symbols)
+		{
+			for (size_t i = 0; i < count; ++i)
+				symbols[i] = GetSymbol(addresses[i]);
+		}
+
 		virtual ~SymbolEngine() {};
 	};
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Hardware Counters API
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct HWCounters
+	{
+		// Current values (called from the owner thread on every marked scope - should be cheap)
+		virtual void Read(HWCounterValues& values) = 0;
+
+		// Values accumulated since the last Start (could be called from any thread)
+		virtual bool ReadTotal(HWCounterValues& values) = 0;
+
+		virtual void Start() = 0;
+		virtual void Stop() = 0;
+
+		virtual ~HWCounters() {};
+	};
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// System Counters API
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	struct SystemCounters
+	{
+		// Attaches current values (or deltas since the previous call) as tags with the given timestamp
+		// Called from the sampler thread only
+		virtual void Sample(EventStorage& storage, int64 timestamp) = 0;
+
+		virtual ~SystemCounters() {};
+	};
 }
 //////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,64 @@
+// The MIT License(MIT)
+//
+// Copyright(c) 2019 Vadim Slyusarev
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#if defined(__linux__) || defined(__APPLE_CC__) || defined(__FreeBSD__)
+
+#include "optick.config.h"
+#if USE_OPTICK
+
+#include "optick_core.platform.h"
+
+#include <unwind.h>
+
+namespace Optick
+{
+	// Callstack capture shared by the posix platforms (libgcc\libunwind unwinder)
+	struct UnwindState
+	{
+		uint64* callstack;
+		uint32 count;
+		uint32 maxCount;
+	};
+
+	static _Unwind_Reason_Code UnwindCallback(_Unwind_Context* context, void* arg)
+	{
+		UnwindState* state = (UnwindState*)arg;
+
+		uintptr_t address = _Unwind_GetIP(context);
+		if (address == 0 || state->count >= state->maxCount)
+			return _URC_END_OF_STACK;
+
+		state->callstack[state->count++] = (uint64)address;
+		return _URC_NO_REASON;
+	}
+
+	uint32 Platform::GetCallstack(uint64* callstack, uint32 maxCount)
+	{
+		UnwindState state = { callstack, 0, maxCount };
+		_Unwind_Backtrace(&UnwindCallback, &state);
+		return state.count;
+	}
+}
+
+#endif //USE_OPTICK
+#endif //__linux__ || __APPLE_CC__ || __FreeBSD__
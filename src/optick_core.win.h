@@ -63,6 +63,36 @@ namespace Optick
 		QueryPerformanceCounter(&largeInteger);
 		return largeInteger.QuadPart;
 	}
+
+	int64 Platform::GetThreadCPUTime()
+	{
+		// Kernel + User time in 100ns units
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+			return 0;
+
+		ULARGE_INTEGER kernel, user;
+		kernel.LowPart = kernelTime.dwLowDateTime;
+		kernel.HighPart = kernelTime.dwHighDateTime;
+		user.LowPart = userTime.dwLowDateTime;
+		user.HighPart = userTime.dwHighDateTime;
+		return (int64)(kernel.QuadPart + user.QuadPart) * 100;
+	}
+
+	uint32 Platform::GetCallstack(uint64* callstack, uint32 maxCount)
+	{
+		// XP\2003 limit the number of frames to 62
+		void* frames[62];
+		USHORT count = RtlCaptureStackBackTrace(0, (DWORD)std::min<uint32>(maxCount, OPTICK_ARRAY_SIZE(frames)), frames, nullptr);
+		for (USHORT i = 0; i < count; ++i)
+			callstack[i] = (uint64)frames[i];
+		return count;
+	}
+
+	bool Platform::GetThreadStack(uint64&, uint64&)
+	{
+		return false;
+	}
 }
 
 #if OPTICK_ENABLE_TRACING
@@ -1731,6 +1761,16 @@ SymbolEngine* Platform::CreateSymbolEngine()
 	return Memory::New<WinSymbolEngine>();
 }
 //////////////////////////////////////////////////////////////////////////
+HWCounters* Platform::CreateHWCounters(ThreadID)
+{
+	return nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
+SystemCounters* Platform::CreateSystemCounters()
+{
+	return nullptr;
+}
+//////////////////////////////////////////////////////////////////////////
 }
 #endif //OPTICK_ENABLE_TRACING
 #endif //USE_OPTICK
@@ -0,0 +1,146 @@
+// The MIT License(MIT)
+//
+// Copyright(c) 2019 Vadim Slyusarev
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include "optick.h"
+
+#include <mutex>
+
+#if (__cplusplus >= 201703L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <shared_mutex>
+#define OPTICK_SHARED_MUTEX (1)
+#endif
+
+#if USE_OPTICK
+namespace Optick
+{
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Instrumented wrapper for Lockable\SharedLockable types (Mode::LOCKS).
+// Contended acquires (try_lock has failed) are shown as wait events (Category::Wait) on the timeline of the thread.
+// Exclusive ownership time is collected as well, per-lock totals are reported in the capture summary.
+// Shared ownership is not tracked (only the contended acquires).
+// Recursive types are supported: only the outermost acquire\release of the owner is recorded.
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class T>
+class Lockable
+{
+	T lockable;
+	const EventDescription* description;
+	// Written by the owner thread only
+	int64_t acquireTimestamp;
+	uint32_t depth;
+
+	Lockable(const Lockable&) = delete;
+	Lockable& operator=(const Lockable&) = delete;
+public:
+	explicit Lockable(const char* name, const char* fileName = nullptr, unsigned long fileLine = 0)
+		: description(EventDescription::CreateShared(name, fileName, fileLine, Category::GetColor(Category::Wait), Category::GetMask(Category::Wait)))
+		, acquireTimestamp(0), depth(0) {}
+
+	void lock()
+	{
+		if (lockable.try_lock())
+		{
+			// Nested acquire of a recursive lock never waits
+			if (depth++ == 0)
+				acquireTimestamp = GetHighPrecisionTime();
+			return;
+		}
+
+		int64_t start = GetHighPrecisionTime();
+		lockable.lock();
+		acquireTimestamp = GetHighPrecisionTime();
+		depth = 1;
+		Lock::Wait(*description, this, start, acquireTimestamp);
+	}
+
+	bool try_lock()
+	{
+		if (!lockable.try_lock())
+			return false;
+
+		if (depth++ == 0)
+			acquireTimestamp = GetHighPrecisionTime();
+		return true;
+	}
+
+	void unlock()
+	{
+		if (--depth > 0)
+		{
+			lockable.unlock();
+			return;
+		}
+
+		int64_t start = acquireTimestamp;
+		int64_t finish = GetHighPrecisionTime();
+		lockable.unlock();
+		Lock::Hold(*description, this, start, finish);
+	}
+
+	void lock_shared()
+	{
+		if (lockable.try_lock_shared())
+			return;
+
+		int64_t start = GetHighPrecisionTime();
+		lockable.lock_shared();
+		Lock::Wait(*description, this, start, GetHighPrecisionTime());
+	}
+
+	bool try_lock_shared() { return lockable.try_lock_shared(); }
+	void unlock_shared() { lockable.unlock_shared(); }
+
+	T& native() { return lockable; }
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef Lockable<std::mutex> Mutex;
+#if defined(OPTICK_SHARED_MUTEX)
+typedef Lockable<std::shared_mutex> SharedMutex;
+#endif
+}
+#else
+namespace Optick
+{
+// Pass-through wrapper to keep the names of the locks compilable
+template<class T>
+class Lockable : public T
+{
+public:
+	explicit Lockable(const char*, const char* = nullptr, unsigned long = 0) {}
+	T& native() { return *this; }
+};
+typedef Lockable<std::mutex> Mutex;
+#if defined(OPTICK_SHARED_MUTEX)
+typedef Lockable<std::shared_mutex> SharedMutex;
+#endif
+}
+#endif
+
+// Declares an instrumented lock of the existing type (named after the variable).
+// Example:
+//		OPTICK_LOCKABLE(std::recursive_mutex, sceneLock);
+//		...
+//		std::lock_guard<Optick::Lockable<std::recursive_mutex>> lock(sceneLock);
+// Notes:
+//		The same works for class members. Optick::Mutex\SharedMutex could be used directly: Optick::Mutex queueLock{ "Queue" };
+#define OPTICK_LOCKABLE(TYPE, VARIABLE) ::Optick::Lockable<TYPE> VARIABLE{ #VARIABLE, __FILE__, __LINE__ }
@@ -57,11 +57,16 @@ namespace Optick
 		static void* (*allocate)(size_t);
 		static void  (*deallocate)(void*);
 		static void  (*initThread)(void);
+
+		// Depth of the Alloc\Free calls on the current thread (heap calls of Optick itself are not reported as allocations of the app)
+		static OPTICK_THREAD_LOCAL uint32_t internalCallDepth;
 	public:
 		static OPTICK_INLINE void* Alloc(size_t size)
 		{
 			size_t totalSize = size + sizeof(Header);
+			++internalCallDepth;
 			void *ptr = allocate(totalSize);
+			--internalCallDepth;
 			OPTICK_VERIFY(ptr, "Can't allocate memory", return nullptr);
 
 			Header* header = (Header*)ptr;
@@ -78,10 +83,17 @@ namespace Optick
 				uint8_t* basePtr = (uint8_t*)p - sizeof(Header);
 				Header* header = (Header*)basePtr;
 				memAllocated -= header->size;
+				++internalCallDepth;
 				deallocate(basePtr);
+				--internalCallDepth;
 			}
 		}
 
+		static OPTICK_INLINE bool IsInternalCall()
+		{
+			return internalCallDepth != 0;
+		}
+
 		static OPTICK_INLINE size_t GetAllocatedSize()
 		{
 			return (size_t)memAllocated;
@@ -253,6 +265,10 @@ namespace Optick
 
 			if (count >= (SIZE - index) && !allowOverlap)
 			{
+				// The skipped tail is serialized with the chunk (e.g. TagStringArena): no stale data from the previous capture
+				if (chunk && index < SIZE)
+					std::memset(&chunk->data[index], 0, sizeof(T) * (SIZE - index));
+
 				AddChunk();
 			}
 
@@ -463,6 +479,17 @@ namespace Optick
 		{
 			MemoryPool<uint8, CHUNK_SIZE>::Clear(preserveMemory);
 		}
+
+		size_t Size() const
+		{
+			return MemoryPool<uint8, CHUNK_SIZE>::Size();
+		}
+
+		template<class Func>
+		void ForEachChunk(Func func) const
+		{
+			MemoryPool<uint8, CHUNK_SIZE>::ForEachChunk(func);
+		}
 	};
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
@@ -30,18 +30,6 @@
 namespace Optick
 {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-struct MessageHeader
-{
-	uint32 mark;
-	uint32 length;
-
-	static const uint32 MESSAGE_MARK = 0xB50FB50F;
-
-	bool IsValid() const { return mark == MESSAGE_MARK; }
-
-	MessageHeader() : mark(0), length(0) {}
-};
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class MessageFactory
 {
 	typedef IMessage* (*MessageCreateFunction)(InputDataStream& str);
@@ -79,7 +67,8 @@ public:
 		MessageHeader header;
 		str.Read(header);
 
-		size_t length = str.Length();
+		// The whole message is already in the buffer (see IMessage::Create)
+		size_t messageEnd = str.GetPosition() + header.length;
 
 		uint16 applicationID = 0;
 		uint16 messageType = IMessage::COUNT;
@@ -87,13 +76,19 @@ public:
 		str >> applicationID;
 		str >> messageType;
 
-		OPTICK_VERIFY( messageType < IMessage::COUNT && factory[messageType] != nullptr, "Unknown message type!", return nullptr )
+		OPTICK_VERIFY( messageType < IMessage::COUNT && factory[messageType] != nullptr, "Unknown message type!", str.SetPosition(messageEnd); return nullptr )
 
 		IMessage* result = factory[messageType](str);
 
-		if (header.length + str.Length() != length)
+		bool isCorrupted = str.IsFailed() || str.GetPosition() != messageEnd;
+
+		// Always continue from the next message
+		str.SetPosition(messageEnd);
+
+		if (isCorrupted)
 		{
 			OPTICK_FAILED("Message Stream is corrupted! Invalid Protocol?")
+			Memory::Delete(result);
 			return nullptr;
 		}
 
@@ -31,7 +31,7 @@
 namespace Optick
 {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-static const uint32 NETWORK_PROTOCOL_VERSION = 26;
+static const uint32 NETWORK_PROTOCOL_VERSION = 29;
 static const uint16 NETWORK_APPLICATION_ID = 0xB50F;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct DataResponse
@@ -60,6 +60,13 @@ struct DataResponse
 		SyscallPack,
 		SummaryPack,
 		FramesPack,
+		WakeupPack,
+		CounterPack,
+		AllocationPack,
+		LockPack,
+		FlowPack,
+		AsyncPack,
+		MarkPack,
 	};
 
 	uint32 version;
@@ -72,6 +79,20 @@ struct DataResponse
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 OutputDataStream& operator << (OutputDataStream& os, const DataResponse& val);
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Client => Server message: MessageHeader + [uint16 applicationID + uint16 messageType + payload] ('length' bytes)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct MessageHeader
+{
+	uint32 mark;
+	uint32 length;
+
+	static const uint32 MESSAGE_MARK = 0xB50FB50F;
+
+	bool IsValid() const { return mark == MESSAGE_MARK; }
+
+	MessageHeader() : mark(0), length(0) {}
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class IMessage
 {
 public:
@@ -85,6 +106,7 @@ public:
 	};
 
 	virtual void Apply() = 0;
+	virtual Type GetType() const = 0;
 	virtual ~IMessage() {}
 
 	static IMessage* Create( InputDataStream& str );
@@ -96,6 +118,7 @@ class Message : public IMessage
 	enum { id = MESSAGE_TYPE };
 public:
 	static uint32 GetMessageType() { return id; }
+	virtual Type GetType() const override { return MESSAGE_TYPE; }
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct CaptureSettings
@@ -94,12 +94,24 @@ namespace Optick
 		return stream;
 	}
 
+	OutputDataStream & operator<<(OutputDataStream &stream, uint16 val)
+	{
+		stream.write( (char*)&val, sizeof(uint16) );
+		return stream;
+	}
+
 	OutputDataStream & operator<<(OutputDataStream &stream, float val)
 	{
 		stream.write((char*)&val, sizeof(float));
 		return stream;
 	}
 
+	OutputDataStream & operator<<(OutputDataStream &stream, double val)
+	{
+		stream.write((char*)&val, sizeof(double));
+		return stream;
+	}
+
 	OutputDataStream & operator<<(OutputDataStream &stream, const string& val)
 	{
 		stream << (uint32)val.length();
@@ -110,84 +122,146 @@ namespace Optick
 
 	OutputDataStream & operator<<(OutputDataStream &stream, const wstring& val)
 	{
+#if WCHAR_MAX > 0xFFFF
+		// The viewer expects UTF-16 strings: converting from UTF-32 (GCC\Clang on Linux and MacOS)
+		vector<uint16> utf16;
+		utf16.reserve(val.length());
+		for (wchar_t symbol : val)
+		{
+			uint32 code = (uint32)symbol;
+			if (code > 0xFFFF)
+			{
+				code -= 0x10000;
+				utf16.push_back((uint16)(0xD800 + (code >> 10)));
+				utf16.push_back((uint16)(0xDC00 + (code & 0x3FF)));
+			}
+			else
+			{
+				utf16.push_back((uint16)code);
+			}
+		}
+		size_t count = utf16.size() * sizeof(uint16);
+		stream << (uint32)count;
+		if (!utf16.empty())
+			stream.write((char*)(&utf16[0]), count);
+#else
 		size_t count = val.length() * sizeof(wchar_t);
 		stream << (uint32)count;
 		if (!val.empty())
 			stream.write((char*)(&val[0]), count);
+#endif
 		return stream;
 	}
 
 	InputDataStream &operator >> (InputDataStream &stream, int16 &val)
 	{
-		stream.read((char*)&val, sizeof(int16));
+		stream.Read(val);
 		return stream;
 	}
 
 	InputDataStream &operator >> ( InputDataStream &stream, int32 &val )
 	{
-		stream.read( (char*)&val, sizeof(int) );
+		stream.Read(val);
 		return stream;
 	}
 
 	InputDataStream &operator >> ( InputDataStream &stream, int64 &val )
 	{
-		stream.read( (char*)&val, sizeof(int64) );
+		stream.Read(val);
 		return stream;
 	}
 
 	InputDataStream & operator>>( InputDataStream &stream, byte &val )
 	{
-		stream.read( (char*)&val, sizeof(byte) );
+		stream.Read(val);
 		return stream;
 	}
 
 	InputDataStream & operator >> (InputDataStream &stream, uint16 &val)
 	{
-		stream.read((char*)&val, sizeof(uint16));
+		stream.Read(val);
 		return stream;
 	}
 
 	InputDataStream & operator>>( InputDataStream &stream, uint32 &val )
 	{
-		stream.read( (char*)&val, sizeof(uint32) );
+		stream.Read(val);
 		return stream;
 	}
 
 	InputDataStream & operator>>( InputDataStream &stream, uint64 &val )
 	{
-		stream.read( (char*)&val, sizeof(uint64) );
+		stream.Read(val);
 		return stream;
 	}
 
 	InputDataStream & operator >> ( InputDataStream &stream, string &val)
 	{
-		int32 length = 0;
-		stream >> length;
-		val.resize(length + 1);
-		stream.read( (char*)&val[0], length);
+		uint32 length = 0;
+		if (!stream.Read(length) || length > stream.Length())
+		{
+			stream.isFailed = true;
+			val.clear();
+			return stream;
+		}
+
+		val.assign(stream.GetData(), length);
+		stream.Skip(length);
 		return stream;
 	}
 
-	InputDataStream::InputDataStream() :
-		stringstream( ios_base::in | ios_base::out )
+	InputDataStream::InputDataStream() : offset(0), isFailed(false)
 	{
 	}
 
-	void InputDataStream::Append(const char *buffer, size_t length)
+	void InputDataStream::Append(const char *data, size_t length)
 	{
-		write( buffer, length );
+		// Compacting consumed data before the buffer grows
+		if (offset == buffer.size())
+		{
+			buffer.clear();
+			offset = 0;
+		}
+		else if (offset > 0 && buffer.size() + length > buffer.capacity())
+		{
+			buffer.erase(buffer.begin(), buffer.begin() + offset);
+			offset = 0;
+		}
+
+		buffer.insert(buffer.end(), data, data + length);
 	}
 
-	size_t InputDataStream::Length()
+	bool InputDataStream::Read(char* data, size_t size)
 	{
-		return (size_t)(tellp() - tellg());
+		if (Length() < size)
+		{
+			isFailed = true;
+			return false;
+		}
+
+		memcpy(data, GetData(), size);
+		return Skip(size);
 	}
 
 	bool InputDataStream::Skip(size_t length)
 	{
-		bool result = Length() <= length;
-		seekg(length, ios_base::cur);
-		return result;
+		if (Length() < length)
+		{
+			isFailed = true;
+			offset = buffer.size();
+		}
+		else
+		{
+			offset += length;
+		}
+
+		return !isFailed;
+	}
+
+	void InputDataStream::SetPosition(size_t position)
+	{
+		offset = position < buffer.size() ? position : buffer.size();
+		isFailed = false;
 	}
 
 
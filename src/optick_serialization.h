@@ -50,11 +50,13 @@ namespace Optick
 		friend OutputDataStream &operator << ( OutputDataStream &stream, int val );
 		friend OutputDataStream &operator << ( OutputDataStream &stream, uint64 val );
 		friend OutputDataStream &operator << ( OutputDataStream &stream, uint32 val );
+		friend OutputDataStream &operator << ( OutputDataStream &stream, uint16 val );
 		friend OutputDataStream &operator << ( OutputDataStream &stream, int64 val );
 		friend OutputDataStream &operator << ( OutputDataStream &stream, char val );
 		friend OutputDataStream &operator << ( OutputDataStream &stream, byte val );
 		friend OutputDataStream &operator << ( OutputDataStream &stream, int8 val);
 		friend OutputDataStream &operator << ( OutputDataStream &stream, float val);
+		friend OutputDataStream &operator << ( OutputDataStream &stream, double val);
 		friend OutputDataStream &operator << ( OutputDataStream &stream, const string& val );
 		friend OutputDataStream &operator << ( OutputDataStream &stream, const wstring& val );
 
@@ -89,36 +91,45 @@ namespace Optick
 	}
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	class InputDataStream : private stringstream {
+	// Linear buffer of the incoming data: consumed bytes are compacted on the next Append
+	class InputDataStream
+	{
+		vector<char> buffer;
+		size_t offset;
+		bool isFailed;
 	public:
-		bool CanRead() { return !eof(); }
+		bool CanRead() const { return !isFailed && Length() > 0; }
+		bool IsFailed() const { return isFailed; }
 
 		InputDataStream();
 
 		void Append(const char *buffer, size_t length);
 		bool Skip(size_t length);
-		size_t Length();
+		size_t Length() const { return buffer.size() - offset; }
+
+		// Unread data (valid until the next Append)
+		const char* GetData() const { return buffer.data() + offset; }
+
+		// Position of the read cursor (valid until the next Append)
+		size_t GetPosition() const { return offset; }
+		void SetPosition(size_t position);
+
+		bool Read(char* data, size_t size);
 
 		template<class T>
-		bool Peek(T& data)
+		bool Peek(T& data) const
 		{
 			if (Length() < sizeof(T))
 				return false;
 
-			pos_type currentPos = tellg();
-			read((char*)&data, sizeof(T));
-			seekg(currentPos);
+			memcpy(&data, GetData(), sizeof(T));
 			return true;
 		}
 
 		template<class T>
 		bool Read(T& data)
 		{
-			if (Length() < sizeof(T))
-				return false;
-
-			read((char*)&data, sizeof(T));
-			return true;
+			return Read((char*)&data, sizeof(T));
 		}
 
 		friend InputDataStream &operator >> (InputDataStream &stream, byte &val );
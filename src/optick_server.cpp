@@ -24,7 +24,6 @@
 
 #if USE_OPTICK
 #include "optick_common.h"
-#include "optick_miniz.h"
 
 #if defined(OPTICK_MSVC)
 #define USE_WINDOWS_SOCKETS (1)
@@ -39,6 +38,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <errno.h>
 typedef int TcpSocket;
 #elif defined(USE_WINDOWS_SOCKETS)
 #include <winsock2.h>
@@ -133,20 +133,72 @@ inline bool SetSocketBlockingMode(TcpSocket socket, bool isBlocking)
 }
 
 
+inline bool IsSocketWouldBlock()
+{
+#if defined(USE_WINDOWS_SOCKETS)
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+#if defined(MSG_NOSIGNAL)
+static const int SOCKET_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SOCKET_SEND_FLAGS = 0;
+#endif
+
+
 class Socket
 {
-	TcpSocket acceptSocket;
+public:
+	struct Client
+	{
+		TcpSocket socket;
+		uint32 id;
+
+		InputDataStream inputStream;
+
+		// Pending data (client sockets are non-blocking, so a slow client doesn't stall the others)
+		vector<char> sendQueue;
+		size_t sendOffset;
+
+		// Client asked for compressed dumps (see Mode::STREAM_COMPRESSION)
+		bool isCompressionRequested;
+
+		Client(TcpSocket s, uint32 clientID) : socket(s), id(clientID), sendOffset(0), isCompressionRequested(false) {}
+
+		size_t GetQueueSize() const { return sendQueue.size() - sendOffset; }
+	};
+
+	enum Stream
+	{
+		ALL_CLIENTS,
+		PLAIN_CLIENTS,
+		COMPRESSED_CLIENTS,
+	};
+
+	typedef vector<Client*> ClientList;
+
+private:
+	static const size_t MAX_CLIENT_COUNT = 16;
+	static const size_t MAX_CLIENT_QUEUE_SIZE = 32 << 20; // 32Mb
+	static const int BACK_PRESSURE_POLL_MS = 10;
+
 	TcpSocket listenSocket;
 	sockaddr_in address;
 
-	fd_set recieveSet;
+	ClientList clients;
+	uint32 nextClientID;
+
+	// Client which has started the current capture (0 - none)
+	uint32 controllerID;
 
 	std::recursive_mutex socketLock;
-	wstring errorMessage;
 
 	void Close()
 	{
-		if (!IsValidSocket(listenSocket))
+		if (IsValidSocket(listenSocket))
 		{
 			CloseSocket(listenSocket);
 		}
@@ -166,17 +218,136 @@ class Socket
 		return false;
 	}
 
-	void Disconnect()
+	void Disconnect(Client& client)
 	{
-		std::lock_guard<std::recursive_mutex> lock(socketLock);
+		if (IsValidSocket(client.socket))
+		{
+			CloseSocket(client.socket);
+		}
+
+		client.sendQueue.clear();
+		client.sendOffset = 0;
+	}
+
+	bool Flush(Client& client)
+	{
+		while (client.GetQueueSize() > 0)
+		{
+			int result = (int)::send(client.socket, &client.sendQueue[client.sendOffset], (int)client.GetQueueSize(), SOCKET_SEND_FLAGS);
+
+			if (result > 0)
+			{
+				client.sendOffset += result;
+			}
+			else
+			{
+				if (result < 0 && IsSocketWouldBlock())
+					break;
+
+				Disconnect(client);
+				return false;
+			}
+		}
 
-		if (!IsValidSocket(acceptSocket))
+		if (client.sendOffset == client.sendQueue.size())
 		{
-			CloseSocket(acceptSocket);
+			client.sendQueue.clear();
+			client.sendOffset = 0;
 		}
+
+		return true;
+	}
+
+	// The controlling (or the only) client gets back-pressure instead of being dropped
+	bool IsBackPressured(const Client& client) const
+	{
+		if (client.id == controllerID)
+			return true;
+
+		for (const Client* other : clients)
+			if (other != &client && IsValidSocket(other->socket))
+				return false;
+
+		return true;
+	}
+
+	// Blocks the dump till the queue of the client drains below the size (the baseline behavior of a blocking socket)
+	// Queues of the other clients keep draining meanwhile, so they are not stalled by the slow one
+	bool WaitForQueue(Client& client, size_t size)
+	{
+		while (IsValidSocket(client.socket) && client.GetQueueSize() > size)
+		{
+			fd_set sendSet;
+			FD_ZERO(&sendSet);
+
+			TcpSocket maxSocket = 0;
+			for (Client* other : clients)
+			{
+				if (IsValidSocket(other->socket) && other->GetQueueSize() > 0)
+				{
+					FD_SET(other->socket, &sendSet);
+					if (other->socket > maxSocket)
+						maxSocket = other->socket;
+				}
+			}
+
+			timeval lim = { 0, BACK_PRESSURE_POLL_MS * 1000 };
+#if defined(USE_BERKELEY_SOCKETS)
+			::select(maxSocket + 1, nullptr, &sendSet, nullptr, &lim);
+#else
+			::select(0, nullptr, &sendSet, nullptr, &lim);
+#endif
+			for (Client* other : clients)
+				Flush(*other);
+		}
+
+		return IsValidSocket(client.socket);
 	}
+
+	void Send(Client& client, const char *buf, size_t len)
+	{
+		if (!IsValidSocket(client.socket))
+			return;
+
+		if (client.GetQueueSize() + len > MAX_CLIENT_QUEUE_SIZE)
+		{
+			if (!IsBackPressured(client))
+			{
+				// The client can't keep up with the others - dropping it right away
+				Disconnect(client);
+				return;
+			}
+
+			if (!WaitForQueue(client, len < MAX_CLIENT_QUEUE_SIZE ? MAX_CLIENT_QUEUE_SIZE - len : 0))
+				return;
+		}
+
+		// Compacting the queue before it grows
+		if (client.sendOffset > 0 && client.sendQueue.size() + len > client.sendQueue.capacity())
+		{
+			client.sendQueue.erase(client.sendQueue.begin(), client.sendQueue.begin() + client.sendOffset);
+			client.sendOffset = 0;
+		}
+
+		client.sendQueue.insert(client.sendQueue.end(), buf, buf + len);
+		Flush(client);
+	}
+
+	bool IsMatching(const Client& client, Stream stream) const
+	{
+		switch (stream)
+		{
+		case PLAIN_CLIENTS:
+			return !client.isCompressionRequested;
+		case COMPRESSED_CLIENTS:
+			return client.isCompressionRequested;
+		default:
+			return true;
+		}
+	}
+
 public:
-	Socket() : acceptSocket((TcpSocket)-1), listenSocket((TcpSocket)-1)
+	Socket() : listenSocket((TcpSocket)-1), nextClientID(1), controllerID(0)
 	{
 #if defined(USE_WINDOWS_SOCKETS)
 		Wsa::Init();
@@ -189,7 +360,13 @@ public:
 
 	~Socket()
 	{
-		Disconnect();
+		for (Client* client : clients)
+		{
+			Disconnect(*client);
+			Memory::Delete(client);
+		}
+		clients.clear();
+
 		Close();
 	}
 
@@ -211,81 +388,120 @@ public:
 		}
 	}
 
-	bool Accept()
+	void Accept()
 	{
-		TcpSocket incomingSocket = ::accept(listenSocket, nullptr, nullptr);
+		std::lock_guard<std::recursive_mutex> lock(socketLock);
 
-		if (IsValidSocket(incomingSocket))
+		while (true)
 		{
-			std::lock_guard<std::recursive_mutex> lock(socketLock);
-			acceptSocket = incomingSocket;
-			SetSocketBlockingMode(acceptSocket, true);
-		}
+			TcpSocket incomingSocket = ::accept(listenSocket, nullptr, nullptr);
+			if (!IsValidSocket(incomingSocket))
+				break;
 
-		return IsValidSocket(acceptSocket);
+			if (clients.size() >= MAX_CLIENT_COUNT)
+			{
+				CloseSocket(incomingSocket);
+				continue;
+			}
+
+			SetSocketBlockingMode(incomingSocket, false);
+			clients.push_back(Memory::New<Client>(incomingSocket, nextClientID++));
+		}
 	}
 
-	bool Send(const char *buf, size_t len)
+	// Removes disconnected clients, flushes pending data and receives incoming data
+	void Update()
 	{
 		std::lock_guard<std::recursive_mutex> lock(socketLock);
 
-		if (!IsValidSocket(acceptSocket))
-			return false;
+		// Incoming data of the clients disconnected during the previous update is already processed
+		for (size_t i = 0; i < clients.size();)
+		{
+			if (!IsValidSocket(clients[i]->socket))
+			{
+				Memory::Delete(clients[i]);
+				clients.erase(clients.begin() + i);
+			}
+			else
+			{
+				++i;
+			}
+		}
 
-		if (::send(acceptSocket, buf, (int)len, 0) >= 0)
+		static const int BUFFER_SIZE = 1024;
+		char buffer[BUFFER_SIZE];
+
+		for (Client* client : clients)
 		{
-			Disconnect();
-			return false;
+			if (!Flush(*client))
+				continue;
+
+			while (IsValidSocket(client->socket))
+			{
+				int length = (int)::recv(client->socket, buffer, BUFFER_SIZE, 0);
+
+				if (length > 0)
+				{
+					client->inputStream.Append(buffer, length);
+				}
+				else
+				{
+					if (length == 0 || !IsSocketWouldBlock())
+						Disconnect(*client);
+					break;
+				}
+			}
 		}
+	}
 
-		return true;
+	void Send(const char *buf, size_t len, Stream stream = ALL_CLIENTS)
+	{
+		std::lock_guard<std::recursive_mutex> lock(socketLock);
+
+		for (Client* client : clients)
+			if (IsMatching(*client, stream))
+				Send(*client, buf, len);
 	}
 
-	int Receive(char *buf, int len)
+	void SendTo(uint32 clientID, const char *buf, size_t len)
 	{
 		std::lock_guard<std::recursive_mutex> lock(socketLock);
 
-		if (!IsValidSocket(acceptSocket))
-			return 0;
+		if (Client* client = GetClient(clientID))
+			Send(*client, buf, len);
+	}
 
-		FD_ZERO(&recieveSet);
-		FD_SET(acceptSocket, &recieveSet);
+	bool HasClients(Stream stream) const
+	{
+		for (const Client* client : clients)
+			if (IsValidSocket(client->socket) && IsMatching(*client, stream))
+				return true;
 
-		static timeval lim = { 0, 0 };
+		return false;
+	}
 
-#if defined(USE_BERKELEY_SOCKETS)
-		if (::select(acceptSocket + 1, &recieveSet, nullptr, nullptr, &lim) == 1)
-#elif defined(USE_WINDOWS_SOCKETS)
-		if (::select(0, &recieveSet, nullptr, nullptr, &lim) == 1)
-#else
-#error Platform not supported
-#endif
-		{
-			return ::recv(acceptSocket, buf, len, 0);
-		}
+	Client* GetClient(uint32 clientID)
+	{
+		for (Client* client : clients)
+			if (client->id == clientID)
+				return client;
 
-		return 0;
+		return nullptr;
 	}
-};
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-struct OptickHeader
-{
-	uint32_t magic;
-	uint16_t version;
-	uint16_t flags;
 
-	static const uint32_t OPTICK_MAGIC = 0xB50FB50Fu;
-	static const uint16_t OPTICK_VERSION = 0;
-	enum Flags : uint16_t
+	const ClientList& GetClients() const
 	{
-		IsZip = 1 << 0,
-		IsMiniz = 1 << 1,
-	};
+		return clients;
+	}
 
-	OptickHeader() : magic(OPTICK_MAGIC), version(OPTICK_VERSION), flags(0) {}
+	void SetControllerID(uint32 clientID)
+	{
+		std::lock_guard<std::recursive_mutex> lock(socketLock);
+		controllerID = clientID;
+	}
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-Server::Server(short port) : socket(Memory::New<Socket>()), saveCb(nullptr)
+Server::Server(short port) : socket(Memory::New<Socket>()), controllerID(0), saveCb(nullptr), collector(nullptr), isSavingToCollector(false), isCompressingStream(false)
 {
 	if (!socket->Bind(port, 4))
 	{
@@ -301,19 +517,61 @@ void Server::Update()
 {
 	std::lock_guard<std::recursive_mutex> lock(socketLock);
 
-	if (!InitConnection())
-		return;
+	socket->Accept();
+	socket->Update();
 
-	int length = -1;
-	while ( (length = socket->Receive( buffer, BIFFER_SIZE ) ) > 0 )
+	if (controllerID != 0 && socket->GetClient(controllerID) == nullptr)
 	{
-		networkStream.Append(buffer, length);
+		controllerID = 0;
+		socket->SetControllerID(controllerID);
 	}
 
-	while (IMessage *message = IMessage::Create(networkStream))
+	const Socket::ClientList& clients = socket->GetClients();
+	for (size_t i = 0; i < clients.size(); ++i)
 	{
-		message->Apply();
-		Memory::Delete(message);
+		Socket::Client* client = clients[i];
+
+		while (IMessage *message = IMessage::Create(client->inputStream))
+		{
+			if (message->GetType() == IMessage::Start)
+			{
+				const CaptureSettings& settings = static_cast<StartMessage*>(message)->settings;
+				client->isCompressionRequested = (settings.mode & Mode::STREAM_COMPRESSION) != 0;
+			}
+
+			if (AcquireControl(client->id, message->GetType()))
+			{
+				message->Apply();
+			}
+			else
+			{
+				OutputDataStream stream;
+				stream << "Capture is controlled by another client";
+				SendTo(client->id, DataResponse::ReportProgress, stream);
+			}
+
+			Memory::Delete(message);
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Server::AcquireControl(uint32 clientID, IMessage::Type type)
+{
+	switch (type)
+	{
+	case IMessage::Start:
+	case IMessage::Stop:
+	case IMessage::Cancel:
+		if (controllerID != 0 && controllerID != clientID)
+			return false;
+
+		// The client which has started a capture keeps the control till the end of the capture
+		controllerID = (type == IMessage::Cancel) ? 0 : clientID;
+		socket->SetControllerID(controllerID);
+		return true;
+
+	default:
+		return true;
 	}
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -322,85 +580,120 @@ void Server::SetSaveCallback(CaptureSaveChunkCb cb)
 	saveCb = cb;
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#if OPTICK_ENABLE_COMPRESSION
-struct ZLibCompressor
+bool Server::AttachCollector(const char* name)
 {
-	static const int BUFFER_SIZE = 1024 << 10; // 1Mb
-	static const int COMPRESSION_LEVEL = Z_BEST_SPEED;
+	std::lock_guard<std::recursive_mutex> lock(socketLock);
 
-	z_stream stream;
-	vector<uint8> buffer;
+	if (collector == nullptr)
+		collector = Memory::New<CollectorChannel>();
 
-	void Init()
+	if (!collector->Open(name ? name : CollectorChannel::DEFAULT_NAME))
 	{
-		buffer.resize(BUFFER_SIZE);
-
-		memset(&stream, 0, sizeof(stream));
-		stream.next_in = nullptr;
-		stream.avail_in = 0;
-		stream.next_out = &buffer[0];
-		stream.avail_out = (uint32)buffer.size();
+		DetachCollector();
+		return false;
+	}
 
-		stream.zalloc = [](void* /*opaque*/, size_t items, size_t size) -> void* { return Memory::Alloc(items * size); };
-		stream.zfree = [](void* /*opaque*/, void *address) { Memory::Free(address); };
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Server::DetachCollector()
+{
+	std::lock_guard<std::recursive_mutex> lock(socketLock);
 
-		if (deflateInit(&stream, COMPRESSION_LEVEL) != Z_OK)
-		{
-			OPTICK_FAILED("deflateInit failed!");
-		}
+	if (collector)
+	{
+		Memory::Delete(collector);
+		collector = nullptr;
 	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Server::SetSaveCollector(const char* path)
+{
+	std::lock_guard<std::recursive_mutex> lock(socketLock);
+
+	if (collector == nullptr || !collector->IsPeerAlive())
+		return false;
 
-	typedef void(*CompressCb)(const char* data, size_t size);
+	saveCb = nullptr;
+	savePath = path;
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Server::CancelSaveCollector()
+{
+	std::lock_guard<std::recursive_mutex> lock(socketLock);
+	savePath.clear();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if OPTICK_ENABLE_COMPRESSION
+void ZLibCompressor::Init()
+{
+	buffer = (uint8*)Memory::Alloc(BUFFER_SIZE);
 
-	void Compress(const char* data, size_t size, CompressCb cb, bool finish = false)
-	{
-		stream.next_in = (const unsigned char*)data;
-		stream.avail_in = (uint32)size;
+	memset(&stream, 0, sizeof(stream));
+	stream.next_in = nullptr;
+	stream.avail_in = 0;
+	stream.next_out = buffer;
+	stream.avail_out = BUFFER_SIZE;
 
-		while (stream.avail_in || finish)
-		{
-			int status = deflate(&stream, finish ? MZ_FINISH : MZ_NO_FLUSH);
+	stream.zalloc = [](void* /*opaque*/, size_t items, size_t size) -> void* { return Memory::Alloc(items * size); };
+	stream.zfree = [](void* /*opaque*/, void *address) { Memory::Free(address); };
 
-			if ((status == Z_STREAM_END) || (stream.avail_out != buffer.size()))
-			{
-				uint32 copmressedSize = (uint32)(buffer.size() - stream.avail_out);
+	if (deflateInit(&stream, COMPRESSION_LEVEL) != Z_OK)
+	{
+		OPTICK_FAILED("deflateInit failed!");
+	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ZLibCompressor::Compress(const char* data, size_t size, CompressCb cb, bool finish)
+{
+	stream.next_in = (const unsigned char*)data;
+	stream.avail_in = (uint32)size;
 
-				cb((const char*)&buffer[0], copmressedSize);
+	while (stream.avail_in || finish)
+	{
+		int status = deflate(&stream, finish ? MZ_FINISH : MZ_NO_FLUSH);
 
-				stream.next_out = &buffer[0];
-				stream.avail_out = (uint32)buffer.size();
-			}
+		if ((status == Z_STREAM_END) || (stream.avail_out != BUFFER_SIZE))
+		{
+			uint32 copmressedSize = (uint32)(BUFFER_SIZE - stream.avail_out);
 
-			if (status == Z_STREAM_END)
-				break;
+			cb((const char*)buffer, copmressedSize);
 
-			if (status != Z_OK)
-			{
-				OPTICK_FAILED("Copmression failed!");
-				break;
-			}
+			stream.next_out = buffer;
+			stream.avail_out = BUFFER_SIZE;
 		}
-	}
 
-	void Finish(CompressCb cb)
-	{
-		Compress(nullptr, 0, cb, true);
+		if (status == Z_STREAM_END)
+			break;
 
-		int status = deflateEnd(&stream);
 		if (status != Z_OK)
 		{
-			OPTICK_FAILED("deflateEnd failed!");
+			OPTICK_FAILED("Copmression failed!");
+			break;
 		}
-		buffer.clear();
-		buffer.shrink_to_fit();
 	}
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ZLibCompressor::Finish(CompressCb cb)
+{
+	Compress(nullptr, 0, cb, true);
 
-	static ZLibCompressor& Get()
+	int status = deflateEnd(&stream);
+	if (status != Z_OK)
 	{
-		static ZLibCompressor compressor;
-		return compressor;
+		OPTICK_FAILED("deflateEnd failed!");
 	}
-};
+
+	Memory::Free(buffer);
+	buffer = nullptr;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ZLibCompressor& ZLibCompressor::Get()
+{
+	static ZLibCompressor compressor;
+	return compressor;
+}
 #endif
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Server::SendStart()
@@ -414,6 +707,24 @@ void Server::SendStart()
 #endif
 		saveCb((const char*)&header, sizeof(header));
 	}
+	else if (!savePath.empty())
+	{
+		// Compression and disk writes are done by the optick-collector process
+		isSavingToCollector = collector->Begin(savePath.c_str());
+		savePath.clear();
+	}
+#if OPTICK_ENABLE_COMPRESSION
+	else if (socket->HasClients(Socket::COMPRESSED_CLIENTS))
+	{
+		// Network dump is framed the same way as a saved capture: OptickHeader + deflate stream
+		OptickHeader header;
+		header.flags |= OptickHeader::IsMiniz;
+		socket->Send((const char*)&header, sizeof(header), Socket::COMPRESSED_CLIENTS);
+
+		ZLibCompressor::Get().Init();
+		isCompressingStream = true;
+	}
+#endif
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Server::Send(const char* data, size_t size)
@@ -426,12 +737,28 @@ void Server::Send(const char* data, size_t size)
 		saveCb(data, size);
 #endif
 	}
+	else if (isSavingToCollector)
+	{
+		isSavingToCollector = collector->Write(data, size);
+	}
+#if OPTICK_ENABLE_COMPRESSION
+	else if (isCompressingStream)
+	{
+		socket->Send(data, size, Socket::PLAIN_CLIENTS);
+		ZLibCompressor::Get().Compress(data, size, SendCompressed);
+	}
+#endif
 	else
 	{
 		socket->Send(data, size);
 	}
 }
-
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Server::SendCompressed(const char* data, size_t size)
+{
+	Server::Get().socket->Send(data, size, Socket::COMPRESSED_CLIENTS);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Server::Send(DataResponse::Type type, OutputDataStream& stream)
 {
 	std::lock_guard<std::recursive_mutex> lock(socketLock);
@@ -446,6 +773,8 @@ void Server::Send(DataResponse::Type type, OutputDataStream& stream)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Server::SendFinish()
 {
+	std::lock_guard<std::recursive_mutex> lock(socketLock);
+
 	OutputDataStream empty;
 	Send(DataResponse::NullFrame, empty);
 
@@ -457,11 +786,40 @@ void Server::SendFinish()
 		saveCb(nullptr, 0);
 		saveCb = nullptr;
 	}
+	else if (isSavingToCollector)
+	{
+		collector->Finish();
+		isSavingToCollector = false;
+	}
+#if OPTICK_ENABLE_COMPRESSION
+	else if (isCompressingStream)
+	{
+		ZLibCompressor::Get().Finish(SendCompressed);
+		isCompressingStream = false;
+	}
+#endif
+
+	// Capture is over, any client could start the next one
+	controllerID = 0;
+	socket->SetControllerID(controllerID);
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool Server::InitConnection()
+void Server::SendTo(uint32 clientID, DataResponse::Type type, OutputDataStream& stream)
 {
-	return socket->Accept();
+	string data = stream.GetData();
+	DataResponse response(type, (uint32)data.size());
+
+	socket->SendTo(clientID, (const char*)&response, sizeof(response));
+	socket->SendTo(clientID, data.c_str(), data.size());
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32 Server::GetStreamFlags() const
+{
+#if OPTICK_ENABLE_COMPRESSION
+	return OptickHeader::IsMiniz;
+#else
+	return 0;
+#endif
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 string Server::GetHostName() const
@@ -488,6 +846,8 @@ Server::~Server()
 		Memory::Delete(socket);
 		socket = nullptr;
 	}
+
+	DetachCollector();
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 Server & Server::Get()
@@ -499,4 +859,4 @@ Server & Server::Get()
 
 }
 
-#endif //USE_OPTICK
\ No newline at end of file
+#endif //USE_OPTICK
\ No newline at end of file
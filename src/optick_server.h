@@ -25,6 +25,8 @@
 
 #if USE_OPTICK
 #include "optick_message.h"
+#include "optick_collector.h"
+#include "optick_miniz.h"
 
 #include <mutex>
 #include <thread>
@@ -34,29 +36,82 @@ namespace Optick
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class Socket;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-class Server
+struct OptickHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t flags;
+
+	static const uint32_t OPTICK_MAGIC = 0xB50FB50Fu;
+	static const uint16_t OPTICK_VERSION = 0;
+	enum Flags : uint16_t
+	{
+		IsZip = 1 << 0,
+		IsMiniz = 1 << 1,
+	};
+
+	OptickHeader() : magic(OPTICK_MAGIC), version(OPTICK_VERSION), flags(0) {}
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if OPTICK_ENABLE_COMPRESSION
+struct OPTICK_API ZLibCompressor
 {
-	InputDataStream networkStream;
+	static const int BUFFER_SIZE = 1024 << 10; // 1Mb
+	static const int COMPRESSION_LEVEL = Z_BEST_SPEED;
 
-	static const int BIFFER_SIZE = 1024;
-	char buffer[BIFFER_SIZE];
+	z_stream stream;
+	uint8* buffer;
 
+	ZLibCompressor() : buffer(nullptr) {}
+
+	typedef void(*CompressCb)(const char* data, size_t size);
+
+	void Init();
+	void Compress(const char* data, size_t size, CompressCb cb, bool finish = false);
+	void Finish(CompressCb cb);
+
+	static ZLibCompressor& Get();
+};
+#endif
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class Server
+{
 	Socket* socket;
 
+	// The client which has started the current capture (0 - none)
+	uint32 controllerID;
+
 	std::recursive_mutex socketLock;
 
 	CaptureSaveChunkCb saveCb;
 
+	CollectorChannel* collector;
+	string savePath;
+	bool isSavingToCollector;
+
+	bool isCompressingStream;
+
 	Server( short port );
 	~Server();
 
-	bool InitConnection();
+	bool AcquireControl(uint32 clientID, IMessage::Type type);
+	void SendTo(uint32 clientID, DataResponse::Type type, OutputDataStream& stream);
 
 	void Send(const char* data, size_t size);
+	static void SendCompressed(const char* data, size_t size);
 
 public:
 	void SetSaveCallback(CaptureSaveChunkCb cb);
 
+	bool AttachCollector(const char* name);
+	void DetachCollector();
+	bool SetSaveCollector(const char* path);
+	// Drops the collector path of a save request which hasn't produced a dump (nothing was captured)
+	void CancelSaveCollector();
+
+	// OptickHeader::Flags applied to the network dumps of the clients which have requested Mode::STREAM_COMPRESSION
+	uint32 GetStreamFlags() const;
+
 	void SendStart();
 	void Send(DataResponse::Type type, OutputDataStream& stream);
 	void SendFinish();
@@ -70,4 +125,4 @@ public:
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 }
 
-#endif //USE_OPTICK
\ No newline at end of file
+#endif //USE_OPTICK
\ No newline at end of file
@@ -0,0 +1,656 @@
+// The MIT License(MIT)
+//
+// Copyright(c) 2019 Vadim Slyusarev
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// optick-capture
+// Headless capture client: connects to a running application, starts a capture and saves the result to an .opt file.
+// Usage:
+//		optick-capture [options] -o capture.opt
+// Options:
+//		-a address			application address (default: 127.0.0.1)
+//		-p port				application port (default: 31318)
+//		-m mode				capture mode: a number or a comma separated list of
+//							instrumentation,tags,autosampling,switch_context,io,gpu,sys_calls,other_processes,cpu_time,system_counters,
+//							allocations,allocation_callstacks,locks
+//		-f frequency		sampling frequency (default: 1000)
+//		--frames N			stop the capture after N frames
+//		--time-ms N			stop the capture after N milliseconds
+//		--spike-ms N		stop the capture on the first frame longer than N milliseconds
+//		--memory-mb N		stop the capture when Optick memory usage reaches N megabytes
+//		--duration-s N		send the stop command after N seconds
+//		--password P		root password for the tracer on the target device
+//		--no-compression	don't ask the application to compress the network stream
+// Ctrl+C stops the capture and saves the data, the second Ctrl+C cancels the capture.
+
+#include "optick_core.h"
+#include "optick_server.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace Optick;
+
+static volatile sig_atomic_t g_InterruptCount = 0;
+
+static void OnSignal(int /*signal*/)
+{
+	++g_InterruptCount;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CaptureFile
+{
+	static FILE*& Get()
+	{
+		static FILE* file = nullptr;
+		return file;
+	}
+
+	// Raw files are written as is, the others are compressed by the client
+	static bool& IsRaw()
+	{
+		static bool isRaw = false;
+		return isRaw;
+	}
+
+	static void Write(const char* data, size_t size)
+	{
+		fwrite(data, 1, size, Get());
+	}
+
+	static bool IsOpen()
+	{
+		return Get() != nullptr;
+	}
+
+	// Compressed network dumps are already framed as .opt files and are saved as is
+	static bool OpenRaw(const char* path)
+	{
+		Close();
+
+		Get() = fopen(path, "wb");
+		IsRaw() = true;
+		return IsOpen();
+	}
+
+	static bool Open(const char* path)
+	{
+		if (!OpenRaw(path))
+			return false;
+
+		IsRaw() = false;
+
+		OptickHeader header;
+#if OPTICK_ENABLE_COMPRESSION
+		ZLibCompressor::Get().Init();
+		header.flags |= OptickHeader::IsMiniz;
+#endif
+		Write((const char*)&header, sizeof(header));
+		return true;
+	}
+
+	static void Append(const char* data, size_t size)
+	{
+#if OPTICK_ENABLE_COMPRESSION
+		ZLibCompressor::Get().Compress(data, size, Write);
+#else
+		Write(data, size);
+#endif
+	}
+
+	static void Close()
+	{
+		if (!IsOpen())
+			return;
+
+#if OPTICK_ENABLE_COMPRESSION
+		if (!IsRaw())
+			ZLibCompressor::Get().Finish(Write);
+#endif
+		fclose(Get());
+		Get() = nullptr;
+	}
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Network data: a sequence of DataResponses, a dump could be compressed (OptickHeader + deflate stream)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct NetworkStream
+{
+	std::string received;
+	std::string decoded;
+
+	bool isCompressionEnabled;
+	bool isInflating;
+#if OPTICK_ENABLE_COMPRESSION
+	mz_stream inflater;
+#endif
+
+	NetworkStream() : isCompressionEnabled(false), isInflating(false) {}
+
+	bool IsDumpHeader() const
+	{
+		uint32 magic = 0;
+		if (!isCompressionEnabled || isInflating || received.size() < sizeof(magic))
+			return false;
+
+		memcpy(&magic, received.c_str(), sizeof(magic));
+		return magic == OptickHeader::OPTICK_MAGIC;
+	}
+
+#if OPTICK_ENABLE_COMPRESSION
+	void BeginInflate()
+	{
+		memset(&inflater, 0, sizeof(inflater));
+		inflater.zalloc = [](void* /*opaque*/, size_t items, size_t size) -> void* { return malloc(items * size); };
+		inflater.zfree = [](void* /*opaque*/, void *address) { free(address); };
+		isInflating = inflateInit(&inflater) == Z_OK;
+	}
+
+	// Returns the number of consumed bytes of the compressed stream
+	size_t Inflate(bool& isFinished)
+	{
+		char output[64 << 10];
+
+		inflater.next_in = (const unsigned char*)received.c_str();
+		inflater.avail_in = (unsigned int)received.size();
+
+		int status = Z_OK;
+		do
+		{
+			inflater.next_out = (unsigned char*)output;
+			inflater.avail_out = sizeof(output);
+			status = inflate(&inflater, Z_NO_FLUSH);
+			decoded.append(output, sizeof(output) - inflater.avail_out);
+		} while (status == Z_OK && inflater.avail_out == 0);
+
+		isFinished = status != Z_OK && status != Z_BUF_ERROR;
+		if (isFinished)
+		{
+			inflateEnd(&inflater);
+			isInflating = false;
+		}
+
+		return received.size() - inflater.avail_in;
+	}
+#endif
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static std::string Base64Encode(const std::string& input)
+{
+	static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string result;
+	for (size_t i = 0; i < input.size(); i += 3)
+	{
+		uint32 triple = (uint8)input[i] << 16;
+		if (i + 1 < input.size()) triple |= (uint8)input[i + 1] << 8;
+		if (i + 2 < input.size()) triple |= (uint8)input[i + 2];
+
+		result += chars[(triple >> 18) & 0x3F];
+		result += chars[(triple >> 12) & 0x3F];
+		result += i + 1 < input.size() ? chars[(triple >> 6) & 0x3F] : '=';
+		result += i + 2 < input.size() ? chars[triple & 0x3F] : '=';
+	}
+	return result;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Numeric options are checked strictly: junk, negative and out of range values are rejected
+static bool ParseNumber(const char* option, const char* text, uint64 scale, uint64 maxValue, uint64& result)
+{
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long value = strtoull(text, &end, 10);
+
+	if (errno != 0 || end == text || *end != 0 || strchr(text, '-') != nullptr || value > maxValue / scale)
+	{
+		fprintf(stderr, "Invalid value of %s: %s\n", option, text);
+		return false;
+	}
+
+	result = (uint64)value * scale;
+	return true;
+}
+
+static bool ParseNumber(const char* option, const char* text, uint64 scale, uint64& result)
+{
+	return ParseNumber(option, text, scale, (uint64)-1, result);
+}
+
+static bool ParseNumber(const char* option, const char* text, uint64 scale, uint32& result)
+{
+	uint64 value = 0;
+	if (!ParseNumber(option, text, scale, (uint32)-1, value))
+		return false;
+
+	result = (uint32)value;
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool ParseMode(const char* text, uint32& mode)
+{
+	struct { const char* name; uint32 mode; } modes[] =
+	{
+		{ "instrumentation", Mode::INSTRUMENTATION },
+		{ "tags", Mode::TAGS },
+		{ "autosampling", Mode::AUTOSAMPLING },
+		{ "switch_context", Mode::SWITCH_CONTEXT },
+		{ "io", Mode::IO },
+		{ "gpu", Mode::GPU },
+		{ "sys_calls", Mode::SYS_CALLS },
+		{ "other_processes", Mode::OTHER_PROCESSES },
+		{ "cpu_time", Mode::CPU_TIME },
+		{ "system_counters", Mode::SYSTEM_COUNTERS },
+		{ "allocations", Mode::ALLOCATIONS },
+		{ "allocation_callstacks", Mode::ALLOCATION_CALLSTACKS },
+		{ "locks", Mode::LOCKS },
+		{ "default", Mode::DEFAULT },
+	};
+
+	char* end = nullptr;
+	mode = (uint32)strtoul(text, &end, 0);
+	if (end != text && *end == 0)
+		return true;
+
+	mode = 0;
+	std::string list(text);
+	size_t start = 0;
+	while (start <= list.size())
+	{
+		size_t finish = list.find(',', start);
+		if (finish == std::string::npos)
+			finish = list.size();
+
+		std::string name = list.substr(start, finish - start);
+		bool isFound = false;
+		for (size_t i = 0; i < OPTICK_ARRAY_SIZE(modes); ++i)
+		{
+			if (name == modes[i].name)
+			{
+				mode |= modes[i].mode;
+				isFound = true;
+			}
+		}
+
+		if (!isFound)
+		{
+			fprintf(stderr, "Unknown mode: %s\n", name.c_str());
+			return false;
+		}
+
+		start = finish + 1;
+	}
+	return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class Connection
+{
+	int socket;
+public:
+	Connection() : socket(-1) {}
+	~Connection() { if (socket >= 0) close(socket); }
+
+	bool Connect(const char* address, const char* port)
+	{
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		addrinfo* result = nullptr;
+		if (getaddrinfo(address, port, &hints, &result) != 0)
+			return false;
+
+		for (addrinfo* it = result; it != nullptr && socket < 0; it = it->ai_next)
+		{
+			socket = ::socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+			if (socket >= 0 && ::connect(socket, it->ai_addr, it->ai_addrlen) != 0)
+			{
+				close(socket);
+				socket = -1;
+			}
+		}
+
+		freeaddrinfo(result);
+		return socket >= 0;
+	}
+
+	bool Send(IMessage::Type type, OutputDataStream& payload)
+	{
+		OutputDataStream body;
+		body << (uint16)NETWORK_APPLICATION_ID << (uint16)type;
+		string data = payload.GetData();
+		body.Write(data.c_str(), data.size());
+		data = body.GetData();
+
+		MessageHeader header;
+		header.mark = MessageHeader::MESSAGE_MARK;
+		header.length = (uint32)data.size();
+
+		return ::send(socket, (const char*)&header, sizeof(header), MSG_NOSIGNAL) == (ssize_t)sizeof(header)
+			&& ::send(socket, data.c_str(), data.size(), MSG_NOSIGNAL) == (ssize_t)data.size();
+	}
+
+	bool Send(IMessage::Type type)
+	{
+		OutputDataStream empty;
+		return Send(type, empty);
+	}
+
+	// Returns -1 on disconnect, 0 on timeout
+	int Receive(char* buffer, size_t size, int timeoutMs)
+	{
+		pollfd fd = { socket, POLLIN, 0 };
+		int status = poll(&fd, 1, timeoutMs);
+		if (status <= 0)
+			return status < 0 && errno != EINTR ? -1 : 0;
+
+		ssize_t length = ::recv(socket, buffer, size, 0);
+		return length > 0 ? (int)length : -1;
+	}
+};
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const char* GetStatusMessage(uint32 status)
+{
+	switch (status)
+	{
+	case CaptureStatus::OK: return nullptr;
+	case CaptureStatus::ERR_TRACER_ALREADY_EXISTS: return "Tracer is already used by another process";
+	case CaptureStatus::ERR_TRACER_ACCESS_DENIED: return "Access denied, run the application with administrator privileges";
+	case CaptureStatus::ERR_TRACER_FAILED: return "Failed to start the tracer";
+	case CaptureStatus::ERR_TRACER_INVALID_PASSWORD: return "Invalid root password";
+	case CaptureStatus::ERR_TRACER_NOT_IMPLEMENTED: return "Tracer is not implemented for the target platform";
+	}
+	return "Unknown tracer status";
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static int PrintUsage(const char* app)
+{
+	printf("Usage: %s [-a address] [-p port] [-m mode] [-f frequency] [--frames N] [--time-ms N] [--spike-ms N] [--memory-mb N] [--duration-s N] [--password P] [--no-compression] -o capture.opt\n", app);
+	return 1;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+	const char* address = "127.0.0.1";
+	const char* port = "31318";
+	const char* output = nullptr;
+	uint32 durationS = 0;
+	bool isCompressionEnabled = true;
+
+	CaptureSettings settings;
+	settings.mode = Mode::DEFAULT;
+	settings.categoryMask = (uint32)-1;
+	settings.samplingFrequency = 1000;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (value == nullptr && strcmp(arg, "--no-compression") != 0)
+			return PrintUsage(argv[0]);
+
+		if (strcmp(arg, "-a") == 0) address = value;
+		else if (strcmp(arg, "-p") == 0) port = value;
+		else if (strcmp(arg, "-o") == 0) output = value;
+		else if (strcmp(arg, "-f") == 0) { if (!ParseNumber(arg, value, 1, settings.samplingFrequency)) return 1; }
+		else if (strcmp(arg, "--frames") == 0) { if (!ParseNumber(arg, value, 1, settings.frameLimit)) return 1; }
+		else if (strcmp(arg, "--time-ms") == 0) { if (!ParseNumber(arg, value, 1000, settings.timeLimitUs)) return 1; }
+		else if (strcmp(arg, "--spike-ms") == 0) { if (!ParseNumber(arg, value, 1000, settings.spikeLimitUs)) return 1; }
+		else if (strcmp(arg, "--memory-mb") == 0) { if (!ParseNumber(arg, value, 1, settings.memoryLimitMb)) return 1; }
+		else if (strcmp(arg, "--duration-s") == 0) { if (!ParseNumber(arg, value, 1, durationS)) return 1; }
+		else if (strcmp(arg, "--no-compression") == 0) { isCompressionEnabled = false; continue; }
+		else if (strcmp(arg, "--password") == 0) settings.password = Base64Encode(value).c_str();
+		else if (strcmp(arg, "-m") == 0)
+		{
+			if (!ParseMode(value, settings.mode))
+				return 1;
+		}
+		else
+			return PrintUsage(argv[0]);
+
+		++i;
+	}
+
+	if (output == nullptr)
+		return PrintUsage(argv[0]);
+
+	if (isCompressionEnabled)
+		settings.mode |= Mode::STREAM_COMPRESSION;
+
+	Connection connection;
+	if (!connection.Connect(address, port))
+	{
+		fprintf(stderr, "Can't connect to %s:%s\n", address, port);
+		return 1;
+	}
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	OutputDataStream startMessage;
+	startMessage << settings.mode
+				 << settings.categoryMask
+				 << settings.samplingFrequency
+				 << settings.frameLimit
+				 << settings.timeLimitUs
+				 << settings.spikeLimitUs
+				 << settings.memoryLimitMb
+				 << settings.password;
+
+	if (!connection.Send(IMessage::Start, startMessage))
+	{
+		fprintf(stderr, "Failed to send the start command\n");
+		return 1;
+	}
+
+	printf("Capturing %s:%s...\n", address, port);
+	fflush(stdout);
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point startTime = Clock::now();
+
+	NetworkStream network;
+	bool isStopSent = false;
+	bool isFinished = false;
+	bool isRawDump = false;
+	char chunk[64 << 10];
+
+	while (!isFinished)
+	{
+		if (g_InterruptCount > 1)
+		{
+			connection.Send(IMessage::Cancel);
+			fprintf(stderr, "\nCapture is cancelled\n");
+			CaptureFile::Close();
+			remove(output);
+			return 1;
+		}
+
+		bool isTimeout = durationS > 0 && Clock::now() - startTime >= std::chrono::seconds(durationS);
+		if (!isStopSent && (g_InterruptCount > 0 || isTimeout))
+		{
+			connection.Send(IMessage::Stop);
+			isStopSent = true;
+		}
+
+		int length = connection.Receive(chunk, sizeof(chunk), 100);
+		if (length < 0)
+			break;
+
+		network.received.append(chunk, length);
+
+		bool isDataAvailable = true;
+		while (isDataAvailable && !isFinished)
+		{
+			isDataAvailable = false;
+
+#if OPTICK_ENABLE_COMPRESSION
+			if (network.IsDumpHeader() && network.received.size() >= sizeof(OptickHeader))
+			{
+				if (!CaptureFile::OpenRaw(output))
+				{
+					fprintf(stderr, "Can't open %s for writing\n", output);
+					return 1;
+				}
+
+				isRawDump = true;
+				CaptureFile::Write(network.received.c_str(), sizeof(OptickHeader));
+				network.received.erase(0, sizeof(OptickHeader));
+				network.BeginInflate();
+			}
+
+			if (network.isInflating)
+			{
+				bool isStreamFinished = false;
+				size_t consumed = network.Inflate(isStreamFinished);
+				CaptureFile::Write(network.received.c_str(), consumed);
+				network.received.erase(0, consumed);
+			}
+#endif
+
+			std::string& responses = isRawDump ? network.decoded : network.received;
+
+			size_t offset = 0;
+			while (responses.size() - offset >= sizeof(DataResponse))
+			{
+				const DataResponse* response = (const DataResponse*)&responses[offset];
+
+				// Compressed dump starts with OptickHeader instead of DataResponse
+				if (!isRawDump && network.isCompressionEnabled && response->version == OptickHeader::OPTICK_MAGIC)
+					break;
+
+				if (responses.size() - offset < sizeof(DataResponse) + response->size)
+					break;
+
+				const char* payload = &responses[offset + sizeof(DataResponse)];
+
+				if (response->version != NETWORK_PROTOCOL_VERSION)
+					fprintf(stderr, "Warning: protocol version mismatch (%u != %u)\n", response->version, NETWORK_PROTOCOL_VERSION);
+
+				switch (response->type)
+				{
+				case DataResponse::Handshake:
+				{
+					uint32 status = 0;
+					memcpy(&status, payload, sizeof(status));
+					if (const char* message = GetStatusMessage(status))
+						fprintf(stderr, "Warning: %s\n", message);
+
+					// uint32 status, string platform, string hostname, uint32 streamFlags
+					size_t position = sizeof(uint32);
+					for (int i = 0; i < 2 && position + sizeof(uint32) <= response->size; ++i)
+					{
+						uint32 stringLength = 0;
+						memcpy(&stringLength, payload + position, sizeof(uint32));
+						position += sizeof(uint32) + stringLength;
+					}
+
+					uint32 streamFlags = 0;
+					if (position + sizeof(uint32) <= response->size)
+						memcpy(&streamFlags, payload + position, sizeof(uint32));
+
+					// Dumps are compressed only for the clients which have asked for that
+					network.isCompressionEnabled = (settings.mode & Mode::STREAM_COMPRESSION) && (streamFlags & OptickHeader::IsMiniz);
+					break;
+				}
+
+				case DataResponse::ReportProgress:
+				{
+					uint32 messageLength = 0;
+					memcpy(&messageLength, payload, sizeof(messageLength));
+					std::string message(payload + sizeof(uint32), messageLength);
+					for (size_t i = 0; i < message.size(); ++i)
+						if (message[i] == '\n')
+							message[i] = ' ';
+					printf("\r%-80s", message.c_str());
+					fflush(stdout);
+					break;
+				}
+
+				default:
+					if (!isRawDump)
+					{
+						if (!CaptureFile::IsOpen() && !CaptureFile::Open(output))
+						{
+							fprintf(stderr, "Can't open %s for writing\n", output);
+							return 1;
+						}
+						CaptureFile::Append((const char*)response, sizeof(DataResponse) + response->size);
+					}
+					isFinished = isFinished || response->type == DataResponse::NullFrame;
+					break;
+				}
+
+				offset += sizeof(DataResponse) + response->size;
+			}
+			responses.erase(0, offset);
+
+			// The compressed dump might start right after the last plain response
+			isDataAvailable = network.IsDumpHeader();
+		}
+	}
+
+#if OPTICK_ENABLE_COMPRESSION
+	if (isFinished && network.isInflating)
+	{
+		// Receiving the tail of the deflate stream
+		bool isStreamFinished = false;
+		while (!isStreamFinished)
+		{
+			size_t consumed = network.Inflate(isStreamFinished);
+			CaptureFile::Write(network.received.c_str(), consumed);
+			network.received.erase(0, consumed);
+
+			if (!isStreamFinished)
+			{
+				int length = connection.Receive(chunk, sizeof(chunk), 1000);
+				if (length <= 0)
+					break;
+				network.received.append(chunk, length);
+			}
+		}
+	}
+#endif
+
+	CaptureFile::Close();
+
+	if (!isFinished)
+	{
+		fprintf(stderr, "\nConnection is closed before the end of the capture\n");
+		remove(output);
+		return 1;
+	}
+
+	printf("\nSaved %s\n", output);
+	return 0;
+}
@@ -0,0 +1,199 @@
+// The MIT License(MIT)
+//
+// Copyright(c) 2019 Vadim Slyusarev
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// optick-collector
+// Receives raw capture streams from the profiled applications (see OPTICK_ATTACH_COLLECTOR) through the shared memory
+// and does compression and disk writes out of the profiled process.
+// Usage:
+//		optick-collector [-n /shared-memory-name] [-s channel-size-mb]
+
+#include "optick_server.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+using namespace Optick;
+
+static volatile sig_atomic_t g_NeedExit = 0;
+
+struct CaptureFile
+{
+	static FILE*& Get()
+	{
+		static FILE* file = nullptr;
+		return file;
+	}
+
+	// Parts of a chunk which didn't fit into the channel at once
+	static std::string& GetPendingData()
+	{
+		static std::string data;
+		return data;
+	}
+
+	static void Write(const char* data, size_t size)
+	{
+		if (Get())
+			fwrite(data, 1, size, Get());
+	}
+
+	// Completes the compressed stream and closes the file (the data received so far stays readable)
+	static void Finish()
+	{
+		FILE*& file = Get();
+		if (file)
+		{
+#if OPTICK_ENABLE_COMPRESSION
+			ZLibCompressor::Get().Finish(Write);
+#endif
+			fclose(file);
+			file = nullptr;
+			printf("Done\n");
+		}
+
+		GetPendingData().clear();
+	}
+};
+
+static void OnRecord(void* /*context*/, CollectorRecord::Type type, const char* data, size_t size)
+{
+	FILE*& file = CaptureFile::Get();
+
+	switch (type)
+	{
+	case CollectorRecord::Start:
+	{
+		std::string path(data, size);
+
+		// The previous capture was interrupted (e.g. the producer has restarted) - keeping what was received
+		CaptureFile::Finish();
+
+		file = fopen(path.c_str(), "wb");
+		if (!file)
+		{
+			fprintf(stderr, "Can't open %s for writing\n", path.c_str());
+			break;
+		}
+
+		printf("Saving %s\n", path.c_str());
+
+		OptickHeader header;
+#if OPTICK_ENABLE_COMPRESSION
+		ZLibCompressor::Get().Init();
+		header.flags |= OptickHeader::IsMiniz;
+#endif
+		CaptureFile::Write((const char*)&header, sizeof(header));
+		break;
+	}
+
+	case CollectorRecord::DataPart:
+		CaptureFile::GetPendingData().append(data, size);
+		break;
+
+	case CollectorRecord::Data:
+	{
+		std::string& pending = CaptureFile::GetPendingData();
+		if (!pending.empty())
+		{
+			pending.append(data, size);
+			data = pending.c_str();
+			size = pending.size();
+		}
+
+#if OPTICK_ENABLE_COMPRESSION
+		if (file)
+			ZLibCompressor::Get().Compress(data, size, CaptureFile::Write);
+#else
+		CaptureFile::Write(data, size);
+#endif
+		pending.clear();
+		break;
+	}
+
+	case CollectorRecord::Finish:
+		CaptureFile::Finish();
+		break;
+	}
+}
+
+static void OnSignal(int /*signal*/)
+{
+	g_NeedExit = 1;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* name = CollectorChannel::DEFAULT_NAME;
+	size_t capacity = CollectorChannel::DEFAULT_CAPACITY;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			name = argv[++i];
+		}
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+		{
+			capacity = (size_t)strtoul(argv[++i], nullptr, 10) << 20;
+		}
+		else
+		{
+			printf("Usage: %s [-n /shared-memory-name] [-s channel-size-mb]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CollectorChannel channel;
+	if (!channel.Create(name, capacity))
+	{
+		fprintf(stderr, "Can't create shared memory channel %s\n", name);
+		return 1;
+	}
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	printf("Collector is listening on %s\n", name);
+
+	while (!g_NeedExit)
+	{
+		if (channel.Read(OnRecord, nullptr) == 0)
+		{
+			// The producer has died in the middle of a capture - nothing else is coming
+			if (CaptureFile::Get() && !channel.IsPeerAlive())
+				CaptureFile::Finish();
+
+			usleep(1000);
+		}
+	}
+
+	// Flushing the data of the last capture
+	channel.Read(OnRecord, nullptr);
+	CaptureFile::Finish();
+	channel.Close();
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+// The MIT License(MIT)
+//
+// Copyright(c) 2019 Vadim Slyusarev
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// optick-malloc-shim
+// Reports heap allocations of the profiled application to Optick (see OPTICK_ALLOC/OPTICK_FREE) without recompiling it.
+// Only threads registered in Optick are tracked, the capture has to be started with Mode::ALLOCATIONS.
+// Usage:
+//		LD_PRELOAD=liboptick-malloc-shim.so ./application
+
+#include "optick.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void* ptr);
+}
+
+#define OPTICK_SHIM_EXPORT extern "C" __attribute__((visibility("default")))
+
+OPTICK_SHIM_EXPORT void* malloc(size_t size)
+{
+	void* ptr = __libc_malloc(size);
+	OPTICK_ALLOC(ptr, size);
+	return ptr;
+}
+
+OPTICK_SHIM_EXPORT void* calloc(size_t count, size_t size)
+{
+	void* ptr = __libc_calloc(count, size);
+	OPTICK_ALLOC(ptr, count * size);
+	return ptr;
+}
+
+OPTICK_SHIM_EXPORT void* realloc(void* ptr, size_t size)
+{
+	void* result = __libc_realloc(ptr, size);
+	// realloc(ptr, 0) frees the block, failed realloc keeps the original one
+	if (result != nullptr || size == 0)
+		OPTICK_FREE(ptr);
+	OPTICK_ALLOC(result, size);
+	return result;
+}
+
+OPTICK_SHIM_EXPORT void free(void* ptr)
+{
+	OPTICK_FREE(ptr);
+	__libc_free(ptr);
+}
+
+OPTICK_SHIM_EXPORT void* memalign(size_t alignment, size_t size)
+{
+	void* ptr = __libc_memalign(alignment, size);
+	OPTICK_ALLOC(ptr, size);
+	return ptr;
+}
+
+OPTICK_SHIM_EXPORT void* aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+OPTICK_SHIM_EXPORT int posix_memalign(void** result, size_t alignment, size_t size)
+{
+	if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+		return EINVAL;
+
+	void* ptr = memalign(alignment, size);
+	if (ptr == nullptr && size != 0)
+		return ENOMEM;
+
+	*result = ptr;
+	return 0;
+}